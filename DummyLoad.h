@@ -79,6 +79,9 @@ public:
     inline double numberRead() override { return m_samples_read; }
     inline double numberWritten() override { return m_samples_written; }
 
+    inline size_t txQueueDepth() override { return 0; }
+    inline size_t txQueueCapacity() override { return 0; }
+
 private:
     void updateTime();
 
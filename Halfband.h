@@ -0,0 +1,131 @@
+/*
+ * Half-band Decimation
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+#ifndef _HALFBAND_H_
+#define _HALFBAND_H_
+
+#include <math.h>
+#include <string.h>
+
+/*
+ * Decimate-by-2 half-band filter. Every other tap of a half-band filter
+ * is zero apart from the centre tap of one half, and the remaining taps
+ * are symmetric, so each output needs only (TAPS + 1) / 4 multiplies on
+ * summed sample pairs. The tap count is a template parameter so the inner
+ * loop is fully unrolled.
+ */
+template <size_t TAPS>
+class HalfbandDecimator {
+	static_assert(TAPS >= 3 && !((TAPS - 3) % 4),
+		      "Half-band length must be of the form 4 * K + 3");
+
+	static const size_t mid = (TAPS - 1) / 2;
+	static const size_t num_coefs = (TAPS + 1) / 4;
+	static const size_t hist_len = TAPS - 1;
+
+public:
+	/* Constructor for half-band decimation
+	 *   @param max_len maximum input block length in samples
+	 */
+	HalfbandDecimator(size_t max_len)
+		: max_len(max_len)
+	{
+		buf = new float[2 * (hist_len + max_len)];
+		memset(buf, 0, 2 * hist_len * sizeof(float));
+
+		initFilter();
+	}
+
+	~HalfbandDecimator()
+	{
+		delete[] buf;
+	}
+
+	/* Decimate a block of samples by 2
+	 *   @param in continuous buffer of input complex float values
+	 *   @param in_len input buffer length, must be even
+	 *   @param out output buffer of in_len / 2 complex float values
+	 *   @return number of samples outputted, negative on error
+	 *
+	 * Filter history is kept internally and output may alias input.
+	 */
+	int decimate(const float *in, size_t in_len, float *out)
+	{
+		if ((in_len % 2) || (in_len > max_len))
+			return -1;
+
+		memcpy(&buf[2 * hist_len], in, in_len * 2 * sizeof(float));
+
+		for (size_t i = 0; i < in_len / 2; i++) {
+			const float *x = &buf[2 * (2 * i + mid)];
+			float re = 0.5f * x[0];
+			float im = 0.5f * x[1];
+
+			for (size_t n = 0; n < num_coefs; n++) {
+				size_t k = 2 * n + 1;
+
+				re += coefs[n] * (x[-2 * k + 0] + x[2 * k + 0]);
+				im += coefs[n] * (x[-2 * k + 1] + x[2 * k + 1]);
+			}
+
+			out[2 * i + 0] = re;
+			out[2 * i + 1] = im;
+		}
+
+		memmove(buf, &buf[2 * in_len], hist_len * 2 * sizeof(float));
+
+		return in_len / 2;
+	}
+
+	/* Get filter length
+	 *   @return number of taps including zeros
+	 */
+	size_t len() { return TAPS; }
+
+private:
+	size_t max_len;
+	float coefs[num_coefs];
+	float *buf;
+
+	/*
+	 * Blackman-Harris windowed sinc with cutoff at a quarter of the
+	 * input rate. Odd taps are scaled so the DC gain is unity with the
+	 * centre tap fixed at one half.
+	 */
+	void initFilter()
+	{
+		float sum = 0.0f;
+
+		for (size_t n = 0; n < num_coefs; n++) {
+			float k = 2 * n + 1;
+			float i = mid + k;
+			float w = 0.35875 -
+				  0.48829 * cos(2 * M_PI * (i + 1) / (TAPS + 1)) +
+				  0.14128 * cos(4 * M_PI * (i + 1) / (TAPS + 1)) -
+				  0.01168 * cos(6 * M_PI * (i + 1) / (TAPS + 1));
+
+			coefs[n] = sin(M_PI * k / 2) / (M_PI * k) * w;
+			sum += 2 * coefs[n];
+		}
+
+		for (size_t n = 0; n < num_coefs; n++)
+			coefs[n] *= 0.5f / sum;
+	}
+};
+
+#endif /* _HALFBAND_H_ */
@@ -33,8 +33,6 @@ extern "C" {
 #define M_PI			3.14159265358979323846264338327f
 #endif
 
-#define MAX_OUTPUT_LEN		4096
-
 static float sinc(float x)
 {
 	if (x == 0.0)
@@ -53,7 +51,7 @@ bool Resampler::initFilters(float bw)
 	/* 
 	 * Allocate partition filters and the temporary prototype filter
 	 * according to numerator of the rational rate. Coefficients are
-	 * real only and must be 16-byte memory aligned for SSE usage.
+	 * real only and must be memory aligned for SIMD usage.
 	 */
 	proto = new float[proto_len];
 	if (!proto)
@@ -65,10 +63,8 @@ bool Resampler::initFilters(float bw)
 		return false;
 	}
 
-	for (size_t i = 0; i < p; i++) {
-		partitions[i] = (float *)
-				memalign(16, filt_len * 2 * sizeof(float));
-	}
+	for (size_t i = 0; i < p; i++)
+		partitions[i] = (float *) convolve_h_alloc(filt_len);
 
 	/* 
 	 * Generate the prototype filter with a Blackman-harris window.
@@ -150,48 +146,61 @@ static bool check_vec_len(int in_len, int out_len, int p, int q)
 		return false;
 	}
 
-	if (out_len > MAX_OUTPUT_LEN) {
-		std::cerr << "Block length of " << out_len
-			  << " exceeds max of " << MAX_OUTPUT_LEN << std::endl;
-		return false;
-	}
-
 	return true;
 }
 
+/*
+ * The commutator path repeats every p outputs, which consume q inputs, so
+ * only a single block of input offsets and partition indices is stored.
+ */
 void Resampler::computePath()
 {
-	for (int i = 0; i < MAX_OUTPUT_LEN; i++) {
+	for (size_t i = 0; i < p; i++) {
 		in_index[i] = (q * i) / p;
 		out_path[i] = (q * i) % p;
 	}
 }
 
+/*
+ * Input offsets are relative to the start of the filter history, so the
+ * leading blocks whose windows reach back into the previous call run from
+ * the history buffer with the head of the input appended. Remaining blocks
+ * run in place on the caller's input.
+ */
 int Resampler::rotate(float *in, size_t in_len, float *out, size_t out_len)
 {
-	int n, path;
-	int hist_len = filt_len - 1;
+	size_t hist_len = filt_len - 1;
+	size_t num_blks, head_blks, head_len;
 
 	if (!check_vec_len(in_len, out_len, p, q))
 		return -1; 
 
-	/* Insert history */
-	memcpy(&in[-2 * hist_len], history, hist_len * 2 * sizeof(float));
+	num_blks = in_len / q;
+	head_blks = num_blks < hist_blks ? num_blks : hist_blks;
+	head_len = in_len < hist_blks * q ? in_len : hist_blks * q;
 
-	/* Generate output from precomputed input/output paths */
-	for (size_t i = 0; i < out_len; i++) {
-		n = in_index[i]; 
-		path = out_path[i]; 
+	memcpy(&history[2 * hist_len], in, head_len * 2 * sizeof(float));
 
-		convolve_real(in, in_len,
-			      partitions[path], filt_len,
-			      &out[2 * i], out_len - i,
-			      n, 1, 1, 0);
+	convolve_polyphase(history, partitions, filt_len,
+			   in_index, out_path, p, q,
+			   out, head_blks);
+
+	if (num_blks > head_blks) {
+		convolve_polyphase(&in[2 * (head_blks * q - hist_len)],
+				   partitions, filt_len,
+				   in_index, out_path, p, q,
+				   &out[2 * head_blks * p],
+				   num_blks - head_blks);
 	}
 
 	/* Save history */
-	memcpy(history, &in[2 * (in_len - hist_len)],
-	       hist_len * 2 * sizeof(float));
+	if (in_len > head_len) {
+		memcpy(history, &in[2 * (in_len - hist_len)],
+		       hist_len * 2 * sizeof(float));
+	} else {
+		memmove(history, &history[2 * in_len],
+			hist_len * 2 * sizeof(float));
+	}
 
 	return out_len;
 }
@@ -204,13 +213,18 @@ bool Resampler::init(float bw)
 	if (initFilters(bw) < 0)
 		return false;
 
-	/* History buffer */
-	history = new float[2 * hist_len];
+	/*
+	 * History buffer with room for the input blocks that overlap it.
+	 * Every window of block i starts at or after i * q samples into
+	 * the history, so blocks with i * q >= hist_len are free of it.
+	 */
+	hist_blks = (hist_len + q - 1) / q;
+	history = new float[2 * (hist_len + hist_blks * q)];
 	memset(history, 0, 2 * hist_len * sizeof(float));
 
 	/* Precompute filterbank paths */
-	in_index = new size_t[MAX_OUTPUT_LEN];
-	out_path = new size_t[MAX_OUTPUT_LEN];
+	in_index = new int[p];
+	out_path = new int[p];
 	computePath();
 
 	return true;
@@ -222,7 +236,8 @@ size_t Resampler::len()
 }
 
 Resampler::Resampler(size_t p, size_t q, size_t filt_len)
-	: in_index(NULL), out_path(NULL), partitions(NULL), history(NULL)
+	: in_index(NULL), out_path(NULL), partitions(NULL), history(NULL),
+	  hist_blks(0)
 {
 	this->p = p;
 	this->q = q;
@@ -233,7 +248,7 @@ Resampler::~Resampler()
 {
 	releaseFilters();
 
-	delete history;
-	delete in_index;
-	delete out_path;
+	delete[] history;
+	delete[] in_index;
+	delete[] out_path;
 }
@@ -51,6 +51,8 @@ public:
          *
 	 * Input and output vector lengths must of be equal multiples of the
 	 * rational conversion rate denominator and numerator respectively.
+	 * There is no limit on block length and filter history is kept
+	 * internally, so no headroom is required in front of the input.
 	 */
 	int rotate(float *in, size_t in_len, float *out, size_t out_len);
 
@@ -63,11 +65,12 @@ private:
 	size_t p;
 	size_t q;
 	size_t filt_len;
-	size_t *in_index;
-	size_t *out_path;
+	int *in_index;
+	int *out_path;
 
 	float **partitions;
 	float *history;
+	size_t hist_blks;
 
 	bool initFilters(float bw);
 	void releaseFilters();
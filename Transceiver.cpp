@@ -28,7 +28,9 @@
 */
 
 
+#include <algorithm>
 #include <cstdio>
+#include <thread>
 
 #define SPDLOG_ACTIVE_LEVEL SPDLOG_LEVEL_DEBUG
 #include "spdlog/spdlog.h"
@@ -50,6 +52,9 @@
 /* Number of running values use in noise average */
 #define NOISE_CNT            20
 
+// FIXME: From GSMTransfer.h
+static const unsigned gSlotLen = 148;	///< number of symbols per slot, not counting guard periods
+
 Transceiver::Transceiver(int wBasePort, const char * TRXAddress, int wSPS, GsmTime wTransmitLatency, RadioInterface * wRadioInterface)
         : mDataSocket(wBasePort + 2, TRXAddress, wBasePort + 102),
           mControlSocket(wBasePort + 1, TRXAddress, wBasePort + 101),
@@ -58,6 +63,19 @@ Transceiver::Transceiver(int wBasePort, const char * TRXAddress, int wSPS, GsmTi
     GsmTime startTime = GsmTime(random() % GsmTime::g_max_frames, 0); // FIXME: Why is this needed?  Should this use the better random generator?
 
     mRxServiceLoopThread = new Thread(32768);
+
+    // Demodulation scales with cores up to one worker per timeslot
+    mNumRxWorkers = std::clamp((int) std::thread::hardware_concurrency(), 1, RX_WORKERS_MAX);
+    for (int i = 0; i < mNumRxWorkers; i++) {
+        mRxWorkers[i].trx = this;
+        mRxWorkers[i].thread = new Thread(32768);
+    }
+    for (int i = 0; i < RX_PENDING_MAX; i++) {
+        mRxJobs[i].done = false;
+        mRxJobs[i].packet.assign(gSlotLen + 10, 0);
+    }
+    mRxDispatchSeq = 0;
+    mRxDeliverSeq = 0;
     mTxServiceLoopThread = new Thread(32768);
     mControlServiceLoopThread = new Thread(32768); // thread to process control messages from GSM core
     mTransmitPriorityQueueServiceLoopThread = new Thread(32768); // thread to process transmit bursts from GSM core
@@ -77,10 +95,12 @@ Transceiver::Transceiver(int wBasePort, const char * TRXAddress, int wSPS, GsmTi
     mTxFreq = 0.0;
     mRxFreq = 0.0;
     mPower = -10;
+    mTxDeviceFormat = false;
     mNoiseLev = 0.0;
 }
 
 Transceiver::~Transceiver() {
+    mRadioInterface->setReceiveFilter(nullptr);
     sigProcLibDestroy();
     mTransmitPriorityQueue.clear();
 }
@@ -96,45 +116,62 @@ bool Transceiver::init() {
 
     // initialize filler tables with dummy bursts
     for (int i = 0; i < 8; i++) {
-        signalVector * modBurst = modulateBurst(gDummyBurst, 8 + (i % 4 == 0), mSPSTx);
-        if (!modBurst) {
-            sigProcLibDestroy();
-            SPDLOG_ERROR("Failed to initialize filler table");
-            return false;
-        }
-
-        scaleVector(*modBurst, txFullScale);
+        GsmTime fillerTime(0, i);
         fillerModulus[i] = 26;
+
+        // All frames of the timeslot share the one dummy burst
+        std::shared_ptr<const radioVector> filler = radioVector::share(fixRadioVector(gDummyBurst, 0, fillerTime));
         for (int j = 0; j < 102; j++) {
-            fillerTable[j][i] = new signalVector(*modBurst);
+            fillerTable[j][i].store(filler);
         }
 
-        delete modBurst;
         mChanType[i] = NONE;
         channelResponse[i] = NULL;
         DFEForward[i] = NULL;
         DFEFeedback[i] = NULL;
         channelEstimateTime[i] = mTransmitDeadlineClock;
         mHandoverActive[i] = false;
+        mEqualizer[i] = EQ_NONE;
     }
 
+    // Only timeslots that expect an uplink burst are sliced out of the receive buffer
+    mRadioInterface->setReceiveFilter([this](const GsmTime &time) {
+        CorrType corrType = expectedCorrType(time);
+        return (corrType != OFF) && (corrType != IDLE);
+    });
+
+    return true;
+}
+
+bool Transceiver::setTxDeviceFormat(bool enable) {
+    if (enable && !mRadioInterface->canPreconvert()) {
+        return false;
+    }
+
+    mTxDeviceFormat = enable;
     return true;
 }
 
-radioVector * Transceiver::fixRadioVector(BitVector &burst,
+radioVector * Transceiver::fixRadioVector(const BitVector &burst,
                                           int RSSI,
                                           GsmTime &wTime) {
 
-    // modulate and stick into queue
-    signalVector * modBurst = modulateBurst(burst,
-                                            8 + (wTime.TN() % 4 == 0),
-                                            mSPSTx);
-    scaleVector(*modBurst, txFullScale * pow(10, -RSSI / 10));
+    // modulate and scale straight into the queued vector
+    int guard = 8 + (wTime.TN() % 4 == 0);
+    size_t len = mSPSTx * (burst.size() + guard);
+    float scale = txFullScale * pow(10, -RSSI / 10);
 
-    radioVector * newVec = new radioVector(*modBurst, wTime);
+    // device format bursts saturate here and need no conversion before sending
+    if (mTxDeviceFormat) {
+        radioVector * newVec = radioVector::makeDevice(wTime, len);
+        modulateBurst(burst, mSPSTx, newVec->deviceSamples(), len, scale);
+        return newVec;
+    }
+
+    radioVector * newVec = radioVector::make(len, 0, 0, wTime);
+    modulateBurst(burst, mSPSTx, *newVec, scale);
     //fillerActive[ARFCN][wTime.TN()] = (ARFCN==0) || (RSSI != 255);
 
-    delete modBurst;
     return newVec;
 }
 
@@ -159,22 +196,17 @@ void Transceiver::unModulateVector(signalVector wVector)
 #endif
 
 // If force, set the FillerTable regardless of channel.
-// If allocate, must allocate a copy of the incoming vector.
-void Transceiver::setFiller(radioVector * rv, bool allocate, bool force) {
+// Filler bursts are never modified, so the table shares rv rather than copying it.
+// Entries are swapped atomically since the transmit loop reads them concurrently.
+void Transceiver::setFiller(std::shared_ptr<const radioVector> rv, bool force) {
     int TN = rv->getTime().TN() & 0x07;    // (pat) Changed to 0x7 from 0x3.
     if (!force && (IGPRS == mChanType[TN])) {
         SPDLOG_INFO("setFiller ignored {}", TN);
-        if (!allocate) { delete rv; }
         return;
     }
     SPDLOG_DEBUG("setFiller {}", TN);
     int modFN = rv->getTime().FN() % fillerModulus[TN];
-    delete fillerTable[modFN][TN];
-    if (allocate) {
-        fillerTable[modFN][TN] = new signalVector(*rv);
-    } else {
-        fillerTable[modFN][TN] = rv;
-    }
+    fillerTable[modFN][TN].store(std::move(rv));
 }
 
 void Transceiver::pushRadioVector(GsmTime &nowTime) {
@@ -184,54 +216,117 @@ void Transceiver::pushRadioVector(GsmTime &nowTime) {
         // Even if the burst is stale, put it in the fillter table.
         // (It might be an idle pattern.)
         SPDLOG_WARN("dumping STALE burst in TRX->USRP interface");
-        setFiller(staleBurst, false, false);
+        setFiller(radioVector::share(staleBurst), false);
     }
 
     // Everything from this point down operates in one TN period,
     int TN = nowTime.TN();
 
-    radioVector * sendVec = NULL;
+    // Bursts are summed straight into the send buffer at the write cursor,
+    // the device sample buffer when bursts are kept in device format
+    std::complex<float> * cursor = NULL;
+    short * deviceCursor = NULL;
+    size_t len = 0;
+
+    auto openCursor = [&](size_t burstLen) {
+        len = burstLen;
+        if (mTxDeviceFormat)
+            deviceCursor = mRadioInterface->getDeviceWriteCursor(len);
+        else
+            cursor = mRadioInterface->getWriteCursor(len);
+    };
+
+    auto addBurst = [&](const radioVector &burst) {
+        if (deviceCursor) {
+            mRadioInterface->addDeviceBurst(deviceCursor, burst.deviceSamples(), len);
+        } else if (cursor) {
+            signalVector sendVec(cursor, 0, len);
+            addVector(sendVec, burst);
+        }
+    };
+
     // if queue contains data at the desired timestamp, stick it into FIFO
     bool addFiller = true;
     while (radioVector * next = (radioVector *) mTransmitPriorityQueue.getCurrentBurst(nowTime)) {
         //LOG(DEBUG) << "transmitFIFO: wrote burst " << next << " at time: " << nowTime;
         //LOG(DEBUG) << (sendVec ? "adding" : "sending") << " burst " << next << " at time: " << nowTime;
         //SPDLOG_DEBUG("{} burst {} at time: {}", (sendVec ? "adding" : "sending"), next, nowTime); // Some issue with serialization
-        setFiller(next, true, false);
-        addFiller = false;
-        if (!sendVec) {
-            sendVec = next;
-        } else {
-            addVector(*sendVec, *next);
-            delete next;
+        std::shared_ptr<const radioVector> burst = radioVector::share(next);
+        setFiller(burst, false);
+        if (addFiller) {
+            openCursor(burst->burstLength());
+            addFiller = false;
         }
+        addBurst(*burst);
     }
 
-    // pull filler data, and set it up to be transmitted
+    // pull filler data, and add it straight from the table
     if (addFiller) {
         int modFN = nowTime.FN() % fillerModulus[TN];
-        radioVector * tmpVec = new radioVector(*fillerTable[modFN][TN], nowTime);
+        std::shared_ptr<const radioVector> filler = fillerTable[modFN][TN].load();
         if (IGPRS == mChanType[TN]) {
-            //LOG(DEBUG) << (sendVec ? "adding" : "setting") << " GPRS filler burst on T" << TN << " FN " << nowTime.FN();
-            SPDLOG_DEBUG("{} GPRS filler burst on T {} FN {}", (sendVec ? "adding" : "setting"), TN, nowTime.FN());
+            //LOG(DEBUG) << "setting GPRS filler burst on T" << TN << " FN " << nowTime.FN();
+            SPDLOG_DEBUG("setting GPRS filler burst on T {} FN {}", TN, nowTime.FN());
         }
-        if (!sendVec) {
-            sendVec = tmpVec;
-        } else {
-            addVector(*sendVec, *tmpVec);
-            delete tmpVec;
+        // an idle timeslot is a copy of the filler already in device format
+        if (!mTxDeviceFormat && mRadioInterface->canPreconvert()) {
+            const ConvertedFiller &converted = convertedFiller(modFN, TN, filler);
+            mRadioInterface->driveTransmitConverted(converted.samples.data(), filler->size());
+            return;
         }
+        openCursor(filler->burstLength());
+        addBurst(*filler);
     }
 
-    //LOG(DEBUG) << "sendVec size: " << sendVec->size();
+    //LOG(DEBUG) << "sendVec size: " << len;
 
-    // What if sendVec is still NULL?
-    // It can't be if there are no NULLs in the filler table.
-    mRadioInterface->driveTransmitRadio(*sendVec, false);
-    delete sendVec;
+    // There is always a burst to send since there are no NULLs in the filler table.
+    // The cursors are NULL when the radio is off.
+    if (cursor)
+        mRadioInterface->commitWriteCursor(len);
+    if (deviceCursor)
+        mRadioInterface->commitDeviceWriteCursor(len);
 
 }
 
+/*
+ * Cache entries are keyed by the filler they were converted from and the
+ * power epoch, so a new filler from setFiller() or a SETPOWER change simply
+ * misses and is converted again. Fillers are shared across frames, so a miss
+ * first looks for the same filler already converted on this timeslot. An
+ * entry no other frame shares is converted in place, reusing its samples.
+ */
+const Transceiver::ConvertedFiller &Transceiver::convertedFiller(int modFN, int TN,
+                                                                 const std::shared_ptr<const radioVector> &filler) {
+    unsigned epoch = mRadioInterface->powerEpoch();
+
+    auto valid = [&](const std::shared_ptr<ConvertedFiller> &entry) {
+        return entry && (entry->source == filler) && (entry->powerEpoch == epoch);
+    };
+
+    std::shared_ptr<ConvertedFiller> &cached = fillerCache[modFN][TN];
+    if (valid(cached)) {
+        return *cached;
+    }
+
+    for (int fn = 0; fn < fillerModulus[TN]; fn++) {
+        if (valid(fillerCache[fn][TN])) {
+            cached = fillerCache[fn][TN];
+            return *cached;
+        }
+    }
+
+    if (!cached || (cached.use_count() > 1))
+        cached = std::make_shared<ConvertedFiller>();
+
+    cached->source = filler;
+    cached->powerEpoch = epoch;
+    cached->samples.resize(2 * filler->size());
+    mRadioInterface->convertBurst(*filler, cached->samples.data());
+
+    return *cached;
+}
+
 void Transceiver::setModulus(int timeslot) {
     switch (mChanType[timeslot]) {
         case NONE:
@@ -342,23 +437,28 @@ Transceiver::CorrType Transceiver::expectedCorrType(GsmTime currTime) {
     SPDLOG_DEBUG("After switch.  Shouldn't get here.");
 }
 
-SoftVector * Transceiver::pullRadioVector(GsmTime &wTime, int &RSSI, int &timingOffset) {
-    bool needDFE = false;
+/*
+ * Runs on the demodulation worker that owns the burst timeslot, so the
+ * per-timeslot channel state needs no locking. Only the noise measurements
+ * are shared between timeslots.
+ */
+bool Transceiver::demodRadioVector(radioVector * rxBurst, unsigned char * bits, GsmTime &wTime, int &RSSI, int &timingOffset) {
     int success = 0;
     std::complex<float> amplitude = 0.0;
     float TOA = 0.0, avg = 0.0;
-
-    radioVector * rxBurst = (radioVector *) mReceiveFIFO->get();
-
-    if (!rxBurst) return NULL;
+    float noiseLev;
 
     int timeslot = rxBurst->getTime().TN();
+    Equalizer equalizer = mEqualizer[timeslot];
+    bool needDFE = (equalizer == EQ_DFE);
+    signalVector * mlseChannel = nullptr;
+    float mlseOffset = 0.0;
 
     CorrType corrType = expectedCorrType(rxBurst->getTime());
 
     if ((corrType == OFF) || (corrType == IDLE)) {
-        delete rxBurst;
-        return NULL;
+        radioVector::recycle(rxBurst);
+        return false;
     }
 
     signalVector * vectorBurst = rxBurst;
@@ -366,60 +466,53 @@ SoftVector * Transceiver::pullRadioVector(GsmTime &wTime, int &RSSI, int &timing
     energyDetect(*vectorBurst, 20 * mSPSRx, 0.0, &avg);
 
     // Update noise level
-    mNoiseLev = mNoises.avg();
+    {
+        ScopedLock lock(mNoiseLock);
+        noiseLev = mNoiseLev = mNoises.avg();
+    }
     avg = sqrt(avg);
 
     // run the proper correlator
     if (corrType == TSC) {
         //SPDLOG_DEBUG("looking for TSC at time: {}", rxBurst->getTime());
-        signalVector * channelResp;
-        double framesElapsed = rxBurst->getTime() - channelEstimateTime[timeslot];
-        bool estimateChannel = false;
-        if ((framesElapsed > 50) || (channelResponse[timeslot] == NULL)) {
-            if (channelResponse[timeslot]) delete channelResponse[timeslot];
-            if (DFEForward[timeslot]) delete DFEForward[timeslot];
-            if (DFEFeedback[timeslot]) delete DFEFeedback[timeslot];
-            channelResponse[timeslot] = NULL;
-            DFEForward[timeslot] = NULL;
-            DFEFeedback[timeslot] = NULL;
-            estimateChannel = true;
-        }
-        if (!needDFE) estimateChannel = false;
+        // The least squares estimate is cheap enough to follow the fading channel on every burst
+        bool estimateChannel = (equalizer != EQ_NONE);
         float chanOffset;
         success = analyzeTrafficBurst(*vectorBurst,
                                       mTSC,
-                                      5.0,
+                                      5.5,
                                       mSPSRx,
                                       &amplitude,
                                       &TOA,
                                       mMaxExpectedDelay,
                                       estimateChannel,
-                                      &channelResp,
+                                      &channelResponse[timeslot],
                                       &chanOffset);
         if (success) {
             //SNRestimate[timeslot] = amplitude.norm2()/(mNoiseLev*mNoiseLev+1.0); // this is not highly accurate
-            SNRestimate[timeslot] = std::norm(amplitude) / (mNoiseLev * mNoiseLev + 1.0); // this is not highly accurate
-            if (estimateChannel) {
-                SPDLOG_DEBUG("estimating channel...");
-                channelResponse[timeslot] = channelResp;
+            SNRestimate[timeslot] = std::norm(amplitude) / (noiseLev * noiseLev + 1.0); // this is not highly accurate
+            if (equalizer == EQ_MLSE) {
+                mlseChannel = channelResponse[timeslot];
+                mlseOffset = chanOffset;
+            } else if (equalizer == EQ_DFE) {
                 chanRespOffset[timeslot] = chanOffset;
                 chanRespAmplitude[timeslot] = amplitude;
-                scaleVector(*channelResp, std::complex<float>(1.0, 0.0) / amplitude);
-                designDFE(*channelResp, SNRestimate[timeslot], 7, &DFEForward[timeslot], &DFEFeedback[timeslot]);
+                scaleVector(*channelResponse[timeslot], std::complex<float>(1.0, 0.0) / amplitude);
+                if (!designDFE(*channelResponse[timeslot], SNRestimate[timeslot], 7, &DFEForward[timeslot], &DFEFeedback[timeslot]))
+                    needDFE = false;
                 channelEstimateTime[timeslot] = rxBurst->getTime();
                 //LOG(DEBUG) << "SNR: " << SNRestimate[timeslot] << ", DFE forward: " << *DFEForward[timeslot]
                 //           << ", DFE backward: " << *DFEFeedback[timeslot];
             }
         } else {
-            channelResponse[timeslot] = NULL;
+            ScopedLock lock(mNoiseLock);
             mNoises.insert(avg);
         }
     } else {
         // RACH burst
         success = detectRACHBurst(*vectorBurst, 6.0, mSPSRx, &amplitude, &TOA);
-        if (success > 0) {
-            channelResponse[timeslot] = NULL;
-        } else if (success == 0) {
+        if (success == 0) {
+            ScopedLock lock(mNoiseLock);
             mNoises.insert(avg);
         } else {
             if (success == -SIGERR_CLIP) {
@@ -428,23 +521,29 @@ SoftVector * Transceiver::pullRadioVector(GsmTime &wTime, int &RSSI, int &timing
                 SPDLOG_ERROR("Unhandled RACH error");
             }
 
-            delete rxBurst;
-            return NULL;
+            radioVector::recycle(rxBurst);
+            return false;
         }
     }
 
     // demodulate burst
-    SoftVector * burst = NULL;
+    bool demodulated = false;
     if ((rxBurst) && (success)) {
-        if ((corrType == RACH) || (!needDFE)) {
-            burst = demodulateBurst(*vectorBurst, mSPSRx, amplitude, TOA);
+        if ((corrType == TSC) && mlseChannel &&
+            equalizeBurstMLSE(*vectorBurst, TOA - mlseOffset, mSPSRx, *mlseChannel, bits, gSlotLen)) {
+            demodulated = true;
+        } else if ((corrType == RACH) || (!needDFE)) {
+            demodulateBurst(*vectorBurst, mSPSRx, amplitude, TOA, bits, gSlotLen);
+            demodulated = true;
         } else {
             scaleVector(*vectorBurst, std::complex<float>(1.0, 0.0) / amplitude);
-            burst = equalizeBurst(*vectorBurst,
-                                  TOA - chanRespOffset[timeslot],
-                                  mSPSRx,
-                                  *DFEForward[timeslot],
-                                  *DFEFeedback[timeslot]);
+            demodulated = equalizeBurst(*vectorBurst,
+                                        TOA - chanRespOffset[timeslot],
+                                        mSPSRx,
+                                        *DFEForward[timeslot],
+                                        *DFEFeedback[timeslot],
+                                        bits,
+                                        std::min<size_t>(gSlotLen, vectorBurst->size()));
         }
         wTime = rxBurst->getTime();
         RSSI = (int) floor(20.0 * log10(rxFullScale / avg));
@@ -454,9 +553,9 @@ SoftVector * Transceiver::pullRadioVector(GsmTime &wTime, int &RSSI, int &timing
 
     //if (burst) LOG(DEBUG) << "burst: " << *burst << '\n';
 
-    delete rxBurst;
+    radioVector::recycle(rxBurst);
 
-    return burst;
+    return demodulated;
 }
 
 void Transceiver::start() {
@@ -515,6 +614,9 @@ void Transceiver::driveControl() {
 
                 // Start radio interface threads.
                 mTxServiceLoopThread->start((void * (*)(void *)) TxServiceLoopAdapter, (void *) this);
+                for (int i = 0; i < mNumRxWorkers; i++) {
+                    mRxWorkers[i].thread->start((void * (*)(void *)) RxWorkerLoopAdapter, (void *) &mRxWorkers[i]);
+                }
                 mRxServiceLoopThread->start((void * (*)(void *)) RxServiceLoopAdapter, (void *) this);
                 mTransmitPriorityQueueServiceLoopThread->start(
                         (void * (*)(void *)) TransmitPriorityQueueServiceLoopAdapter, (void *) this);
@@ -593,8 +695,8 @@ void Transceiver::driveControl() {
         if (mOn)
             sprintf(response, "RSP SETTSC 1 %d", TSC);
         else {
+            // Every midamble was generated by sigProcLibSetup()
             mTSC = TSC;
-            generateMidamble(mSPSRx, TSC);
             sprintf(response, "RSP SETTSC 0 %d", TSC);
         }
     } else if (strcmp(command, "HANDOVER") == 0) {
@@ -633,6 +735,18 @@ void Transceiver::driveControl() {
         setModulus(timeslot);
         sprintf(response, "RSP SETSLOT 0 %d %d", timeslot, corrCode);
 
+    } else if (strcmp(command, "SETEQ") == 0) {
+        // select the uplink equalizer of a timeslot
+        int timeslot;
+        int equalizer;
+        sscanf(buffer, "%3s %s %d %d", cmdcheck, command, &timeslot, &equalizer);
+        if ((timeslot < 0) || (timeslot > 7) || (equalizer < EQ_NONE) || (equalizer > EQ_MLSE)) {
+            SPDLOG_WARN("bogus message on control interface");
+            sprintf(response, "RSP SETEQ 1 %d %d", timeslot, equalizer);
+        } else {
+            mEqualizer[timeslot] = (Equalizer) equalizer;
+            sprintf(response, "RSP SETEQ 0 %d %d", timeslot, equalizer);
+        }
     } else if (strcmp(command, "READFACTORY") == 0) {
         // TODO: Actually support reading data from various USRPs
         int ret = 0; //fail everything -kurtis
@@ -648,7 +762,6 @@ void Transceiver::driveControl() {
 }
 
 // FIXME: From GSMTransfer.h
-static const unsigned gSlotLen = 148;	///< number of symbols per slot, not counting guard periods
 
 bool Transceiver::driveTransmitPriorityQueue() {
 
@@ -706,7 +819,7 @@ bool Transceiver::driveTransmitPriorityQueue() {
     radioVector * newVec = fixRadioVector(newBurst, RSSI, currTime);
 
     if (fillerFlag) {
-        setFiller(newVec, false, true);
+        setFiller(radioVector::share(newVec), true);
     } else {
         mTransmitPriorityQueue.write(newVec);
     }
@@ -718,43 +831,88 @@ bool Transceiver::driveTransmitPriorityQueue() {
 
 }
 
+/*
+ * Received bursts are numbered in arrival order and handed to the worker of
+ * their timeslot. Dispatch stops once RX_PENDING_MAX bursts are in flight,
+ * leaving the rest in the receive FIFO so the radio interface backs off, and
+ * so a job slot is only reused once its previous burst has been delivered.
+ * With the window full the loop sleeps until a delivery frees a slot.
+ */
 void Transceiver::driveReceiveFIFO() {
 
-    SoftVector * rxBurst = NULL;
-    int RSSI;
-    int TOA;  // in 1/256 of a symbol
-    GsmTime burstTime = GsmTime();
+    {
+        ScopedLock lock(mRxDeliverLock);
+        while (mRxDispatchSeq - mRxDeliverSeq >= RX_PENDING_MAX)
+            mRxDeliverSignal.wait(mRxDeliverLock);
+    }
 
     mRadioInterface->driveReceiveRadio();
 
-    rxBurst = pullRadioVector(burstTime, RSSI, TOA);
+    while (mRxDispatchSeq - mRxDeliverSeq < RX_PENDING_MAX) {
+        radioVector * rxBurst = mReceiveFIFO->get();
+        if (!rxBurst)
+            break;
+
+        RxJob &job = mRxJobs[mRxDispatchSeq % RX_PENDING_MAX];
+        job.burst = rxBurst;
+        job.seq = mRxDispatchSeq++;
+        mRxWorkers[rxBurst->getTime().TN() % mNumRxWorkers].queue.write(&job);
+    }
+}
+
+void Transceiver::driveRxWorker(RxWorker &worker) {
+    RxJob * job = worker.queue.read();
 
-    if (rxBurst) {
+    job->valid = demodRadioVector(job->burst, (unsigned char *) &job->packet[8], job->time, job->RSSI, job->TOA);
+    deliverRxBurst(*job);
+}
+
+/*
+ * Workers finish out of order, so jobs wait here until every earlier burst
+ * has been delivered. Bursts that did not demodulate still take their turn so
+ * later ones are not held back.
+ */
+void Transceiver::deliverRxBurst(RxJob &job) {
+    ScopedLock lock(mRxDeliverLock);
+    uint64_t first = mRxDeliverSeq;
+
+    job.done = true;
+
+    for (;;) {
+        RxJob &next = mRxJobs[mRxDeliverSeq % RX_PENDING_MAX];
+        if (!next.done || (next.seq != mRxDeliverSeq))
+            break;
+
+        if (next.valid) {
+            writeRxBurst(next.packet.data(), next.time, next.RSSI, next.TOA);
+        }
+        next.done = false;
+        mRxDeliverSeq++;
+    }
+
+    if (mRxDeliverSeq != first)
+        mRxDeliverSignal.signal();
+}
+
+/*
+ * The packet is gSlotLen + 10 bytes with the soft bits already demodulated
+ * into it from byte 8, one byte per bit, and the trailing bytes zeroed.
+ */
+void Transceiver::writeRxBurst(char * packet, GsmTime &burstTime, int RSSI, int TOA) {
 
 //        LOG(DEBUG) << "burst parameters: "
 //                   << " time: " << burstTime
 //                   << " RSSI: " << RSSI
-//                   << " TOA: " << TOA
-//                   << " bits: " << *rxBurst;
-
-        char burstString[gSlotLen + 10];
-        burstString[0] = burstTime.TN();
-        for (int i = 0; i < 4; i++)
-            burstString[1 + i] = (burstTime.FN() >> ((3 - i) * 8)) & 0x0ff;
-        burstString[5] = RSSI;
-        burstString[6] = (TOA >> 8) & 0x0ff;
-        burstString[7] = TOA & 0x0ff;
-        SoftVector::iterator burstItr = rxBurst->begin();
-
-        for (unsigned int i = 0; i < gSlotLen; i++) {
-            burstString[8 + i] = (char) round((*burstItr++) * 255.0);
-        }
-        burstString[gSlotLen + 9] = '\0';
-        delete rxBurst;
+//                   << " TOA: " << TOA;
 
-        mDataSocket.write(burstString, gSlotLen + 10);
-    }
+    packet[0] = burstTime.TN();
+    for (int i = 0; i < 4; i++)
+        packet[1 + i] = (burstTime.FN() >> ((3 - i) * 8)) & 0x0ff;
+    packet[5] = RSSI;
+    packet[6] = (TOA >> 8) & 0x0ff;
+    packet[7] = TOA & 0x0ff;
 
+    mDataSocket.write(packet, gSlotLen + 10);
 }
 
 void Transceiver::driveTransmitFIFO() {
@@ -775,15 +933,21 @@ void Transceiver::driveTransmitFIFO() {
     if (mOn) {
         //radioClock->wait(); // wait until clock updates
         //LOG(DEBUG) << "radio clock " << radioClock->get();
+        // queued devices adapt too, but never run further ahead than half their queue holds
+        unsigned maxLatency = mRadioInterface->txQueueFrames() / 2;
+        bool adaptive = maxLatency || (mRadioInterface->getWindowType() == RadioDevice::TX_WINDOW_USRP1);
+
         while (radioClock->get() + mTransmitLatency > mTransmitDeadlineClock) {
             // if underrun, then we're not providing bursts to radio/USRP fast
             //   enough.  Need to increase latency by one GSM frame.
-            if (mRadioInterface->getWindowType() == RadioDevice::TX_WINDOW_USRP1) {
+            if (adaptive) {
                 if (mRadioInterface->isUnderrun()) {
                     // only update latency at the defined frame interval
-                    if (radioClock->get() > mLatencyUpdateTime + GsmTime(USB_LATENCY_INTRVL)) {
+                    if ((radioClock->get() > mLatencyUpdateTime + GsmTime(USB_LATENCY_INTRVL)) &&
+                        (!maxLatency || (mTransmitLatency < GsmTime(maxLatency, 0)))) {
                         mTransmitLatency = mTransmitLatency + GsmTime(1, 0);
-                        //LOG(INFO) << "new latency: " << mTransmitLatency;
+                        SPDLOG_INFO("Transmit latency raised to {}:{} with {} samples queued",
+                                    mTransmitLatency.FN(), mTransmitLatency.TN(), mRadioInterface->txQueueDepth());
                         mLatencyUpdateTime = radioClock->get();
                     }
                 } else {
@@ -831,6 +995,16 @@ void * RxServiceLoopAdapter(Transceiver * transceiver) {
     return NULL;
 }
 
+void * RxWorkerLoopAdapter(Transceiver::RxWorker * worker) {
+    worker->trx->setPriority();
+
+    while (1) {
+        worker->trx->driveRxWorker(*worker);
+        pthread_testcancel();
+    }
+    return NULL;
+}
+
 void * TxServiceLoopAdapter(Transceiver * transceiver) {
     while (1) {
         transceiver->driveTransmitFIFO();
@@ -5,6 +5,11 @@
 #include <sys/types.h>
 #include <sys/socket.h>
 
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
 #include "gsmtime.h"
 #include "radioInterface.h"
 #include "Interthread.h"
@@ -17,6 +22,12 @@
 /** Define this to be the slot number to be logged. */
 //#define TRANSMIT_LOGGING 1
 
+/** Maximum number of uplink demodulation workers, one per timeslot */
+#define RX_WORKERS_MAX 8
+
+/** Maximum number of uplink bursts between dispatch and delivery */
+#define RX_PENDING_MAX 16
+
 /** The Transceiver class, responsible for physical layer of basestation */
 class Transceiver {
 
@@ -69,26 +80,88 @@ private:
         IGPRS                ///< GPRS channel, like I but static filler frames.
     } ChannelCombination;
 
+    /** Uplink equalizers, selected per timeslot */
+    typedef enum {
+        EQ_NONE,            ///< soft slicing of the burst, default
+        EQ_DFE,             ///< decision feedback equalizer
+        EQ_MLSE             ///< Viterbi sequence estimator over the channel estimate
+    } Equalizer;
+
     float mNoiseLev;      ///< Average noise level
     noiseVector mNoises;  ///< Vector holding running noise measurements
+    Mutex mNoiseLock;     ///< noise measurements are shared by all demodulation workers
+
+    /** Uplink burst in flight, from dispatch to a worker until it is written to the GSM core in order */
+    struct RxJob {
+        radioVector * burst;  ///< received burst, recycled by the worker
+        uint64_t seq;         ///< place in the uplink delivery order
+        bool done;            ///< demodulation finished, waiting for its turn
+        bool valid;           ///< packet holds a demodulated burst
+        std::vector<char> packet;  ///< burst as written to the GSM core, soft bits are demodulated straight into it
+        GsmTime time;
+        int RSSI;
+        int TOA;
+    };
+
+    /** Job queue on recycled list nodes, jobs belong to mRxJobs and are never freed by the queue */
+    class RxJobQueue : public InterthreadQueueWithWait<RxJob> {
+        void freeElement(RxJob *) const override {}
+
+    public:
+        ~RxJobQueue() override { clear(); }
+    };
+
+    /** Demodulation worker, owns all per-timeslot receive state of the timeslots mapped to it */
+    struct RxWorker {
+        Transceiver * trx;
+        Thread * thread;
+        RxJobQueue queue;
+    };
+
+    int mNumRxWorkers;                        ///< number of demodulation workers, timeslot TN goes to TN % mNumRxWorkers
+    RxWorker mRxWorkers[RX_WORKERS_MAX];      ///< uplink demodulation workers
+    RxJob mRxJobs[RX_PENDING_MAX];            ///< bursts in flight, burst seq uses mRxJobs[seq % RX_PENDING_MAX]
+    uint64_t mRxDispatchSeq;                  ///< sequence number of the next burst handed to a worker
+    std::atomic<uint64_t> mRxDeliverSeq;      ///< sequence number of the next burst written to the GSM core
+    Mutex mRxDeliverLock;
+    Signal mRxDeliverSignal;                  ///< signalled when mRxDeliverSeq advances, wakes a dispatcher with a full window
 
     /** unmodulate a modulated burst */
 #ifdef TRANSMIT_LOGGING
     void unModulateVector(signalVector wVector);
 #endif
 
-    void setFiller(radioVector * rv, bool allocate, bool force);
+    /** Share a burst as the filler for its timeslot and frame, force also sets IGPRS timeslots */
+    void setFiller(std::shared_ptr<const radioVector> rv, bool force);
 
     /** modulate and add a burst to the transmit queue */
-    radioVector * fixRadioVector(BitVector &burst, int RSSI, GsmTime &wTime);
+    radioVector * fixRadioVector(const BitVector &burst, int RSSI, GsmTime &wTime);
 
     /** Push modulated burst into transmit FIFO corresponding to a particular timestamp */
     void pushRadioVector(GsmTime &nowTime);
 
-    /** Pull and demodulate a burst from the receive FIFO */
-    SoftVector * pullRadioVector(GsmTime &wTime,
-                                 int &RSSI,
-                                 int &timingOffset);
+    /** Filler burst converted to device samples at one transmit power setting */
+    struct ConvertedFiller {
+        std::shared_ptr<const radioVector> source;    ///< filler waveform the samples were converted from
+        unsigned powerEpoch;                          ///< radio interface power epoch at conversion
+        std::vector<short> samples;                   ///< interleaved device samples
+    };
+
+    /** Return the filler converted to device samples, converting it again if stale */
+    const ConvertedFiller &convertedFiller(int modFN, int TN, const std::shared_ptr<const radioVector> &filler);
+
+    /** Demodulate a received burst into wire format soft bits, takes ownership of rxBurst, returns false if nothing was demodulated */
+    bool demodRadioVector(radioVector * rxBurst,
+                          unsigned char * bits,
+                          GsmTime &wTime,
+                          int &RSSI,
+                          int &timingOffset);
+
+    /** Mark a job finished and write all bursts that are now in order to the GSM core */
+    void deliverRxBurst(RxJob &job);
+
+    /** Fill in the header of a demodulated burst packet and write it to the GSM core */
+    void writeRxBurst(char * packet, GsmTime &burstTime, int RSSI, int TOA);
 
     /** Set modulus for specific timeslot */
     void setModulus(int timeslot);
@@ -107,10 +180,13 @@ private:
     double mTxFreq;                      ///< the transmit frequency
     double mRxFreq;                      ///< the receive frequency
     int mPower;                          ///< the transmit power in dB
+    bool mTxDeviceFormat;                ///< transmit bursts are modulated straight to device samples
     unsigned mTSC;                       ///< the midamble sequence code
     int fillerModulus[8];                ///< modulus values of all timeslots, in frames
-    signalVector * fillerTable[102][8];   ///< table of modulated filler waveforms for all timeslots
+    std::atomic<std::shared_ptr<const radioVector>> fillerTable[102][8];   ///< table of shared, immutable filler waveforms for all timeslots
+    std::shared_ptr<ConvertedFiller> fillerCache[102][8];   ///< fillers in device format, only used by the transmit loop
     bool mHandoverActive[8];
+    Equalizer mEqualizer[8];               ///< uplink equalizer of all timeslots
     unsigned mMaxExpectedDelay;            ///< maximum expected time-of-arrival offset in GSM symbols
 
     GsmTime channelEstimateTime[8]; ///< last timestamp of each timeslot's channel estimate
@@ -140,6 +216,10 @@ public:
 
     bool init();
 
+    /** keep transmit bursts as 16-bit device samples from modulation on, call before init(),
+        returns false if the radio interface cannot take preconverted bursts */
+    bool setTxDeviceFormat(bool enable);
+
     /** attach the radioInterface receive FIFO */
     void receiveFIFO(VectorFIFO * wFIFO) { mReceiveFIFO = wFIFO; }
 
@@ -155,9 +235,12 @@ public:
 
 protected:
 
-    /** drive reception and demodulation of GSM bursts */
+    /** drive reception of GSM bursts and hand them to the demodulation workers */
     void driveReceiveFIFO();
 
+    /** demodulate the bursts queued for one worker */
+    void driveRxWorker(RxWorker &worker);
+
     /** drive transmission of GSM bursts */
     void driveTransmitFIFO();
 
@@ -172,6 +255,8 @@ protected:
 
     friend void * RxServiceLoopAdapter(Transceiver *);
 
+    friend void * RxWorkerLoopAdapter(RxWorker *);
+
     friend void * TxServiceLoopAdapter(Transceiver *);
 
     friend void * ControlServiceLoopAdapter(Transceiver *);
@@ -188,6 +273,9 @@ protected:
 /** Main drive threads */
 void * RxServiceLoopAdapter(Transceiver *);
 
+/** uplink demodulation worker thread loop */
+void * RxWorkerLoopAdapter(Transceiver::RxWorker *);
+
 void * TxServiceLoopAdapter(Transceiver *);
 
 /** control message handler thread loop */
@@ -1078,7 +1078,7 @@ SoftVector *Demodulator::demodRadioVector(radioVector *rxBurst,
   bool success = false;
   if (corrType==TSC) {
     DEMOD_DEBUG << "looking for TSC at time: " << rxBurst->time();
-    signalVector *channelResp;
+    signalVector *channelResp = NULL;
     double framesElapsed = rxBurst->time()-channelEstimateTime[timeslot];
     bool estimateChannel = false;
     //if ((framesElapsed > 50) || (channelResponse[timeslot]==NULL))
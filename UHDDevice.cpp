@@ -80,6 +80,24 @@ void * async_event_loop(uhd_device *dev) {
     return nullptr;
 }
 
+void * rx_stream_loop(uhd_device *dev) {
+    dev->setPriority();
+
+    while (dev->recv_rx_pkt())
+        ;
+
+    return nullptr;
+}
+
+void * tx_stream_loop(uhd_device *dev) {
+    dev->setPriority();
+
+    while (dev->send_tx_pkt())
+        ;
+
+    return nullptr;
+}
+
 
 uhd_device::uhd_device(int sps, bool skip_rx) {
     this->samples_per_symbol = sps;
@@ -91,6 +109,7 @@ uhd_device::~uhd_device() {
     stop();
 
     delete rx_smpl_buf;
+    delete tx_queue;
 }
 
 void uhd_device::init_gains() {
@@ -317,9 +336,16 @@ int uhd_device::open(const std::string &args, ReferenceType ref) {
     tx_spp = tx_stream->get_max_num_samps();
     rx_spp = rx_stream->get_max_num_samps();
 
+    // Receive rate is raised for every half-band stage the host runs
+    int rx_halfbands = 0;
+    if (dev_type == B100)
+        rx_halfbands = RESAMP_64M_RX_HALFBANDS;
+    else if ((dev_type == USRP2) || (dev_type == X3XX))
+        rx_halfbands = RESAMP_100M_RX_HALFBANDS;
+
     // Set rates
     double _tx_rate = select_rate(dev_type, samples_per_symbol);
-    double _rx_rate = _tx_rate / samples_per_symbol;
+    double _rx_rate = _tx_rate / samples_per_symbol * (1 << rx_halfbands);
     if ((_tx_rate > 0.0) && (set_rates(_tx_rate, _rx_rate) < 0))
         return -1;
 
@@ -328,6 +354,13 @@ int uhd_device::open(const std::string &args, ReferenceType ref) {
     size_t buf_len = SAMPLE_BUF_SZ / sizeof(uint32_t);
     rx_smpl_buf = new smpl_buf(buf_len, rx_rate);
 
+    // Create transmit queue
+    tx_queue = new tx_buf();
+    if (!tx_queue->init(TX_QUEUE_LEN, TX_QUEUE_SLOTS)) {
+        SPDLOG_ERROR("Failed to allocate the transmit queue");
+        return -1;
+    }
+
     // Set receive chain sample offset
     double offset = get_dev_offset(dev_type, samples_per_symbol);
     if (offset == 0.0) {
@@ -416,6 +449,18 @@ bool uhd_device::start() {
     // Start streaming
     restart(uhd::time_spec_t(0.0));
 
+    // Start the receive thread, which owns the receive streamer from here on
+    if (!skip_rx) {
+        rx_smpl_buf->resume();
+        rx_running = true;
+        rx_stream_thrd.start((void *(*)(void *)) rx_stream_loop, (void *) this);
+    }
+
+    // Start the transmit thread, which owns the transmit streamer from here on
+    tx_queue->resume();
+    tx_running = true;
+    tx_stream_thrd.start((void *(*)(void *)) tx_stream_loop, (void *) this);
+
     // Display usrp time
     double time_now = usrp_dev->get_time_now().get_real_secs();
     SPDLOG_INFO("The current time is {} seconds", time_now);
@@ -428,6 +473,18 @@ bool uhd_device::stop() {
     SPDLOG_INFO("Stoping the USRP Device");
     uhd::stream_cmd_t stream_cmd = uhd::stream_cmd_t::STREAM_MODE_STOP_CONTINUOUS;
 
+    // Release any waiting reader and stop receiving before the stream ends
+    if (rx_running.exchange(false)) {
+        rx_smpl_buf->cancel();
+        rx_stream_thrd.join();
+    }
+
+    // Buffers still queued are abandoned with the stream
+    if (tx_running.exchange(false)) {
+        tx_queue->cancel();
+        tx_stream_thrd.join();
+    }
+
     usrp_dev->issue_stream_cmd(stream_cmd);
 
     started = false;
@@ -480,8 +537,6 @@ int uhd_device::check_rx_md_err(uhd::rx_metadata_t &md, ssize_t num_smpls) {
 int uhd_device::readSamples(short *buf, int len, bool *overrun, TIMESTAMP timestamp, bool *underrun, unsigned *RSSI) {
     ssize_t rc;
     uhd::time_spec_t ts;
-    uhd::rx_metadata_t metadata;
-    uint32_t pkt_buf[rx_spp];
 
     // FIXME: Why would RX be skipped?
     if (skip_rx) {
@@ -497,49 +552,16 @@ int uhd_device::readSamples(short *buf, int len, bool *overrun, TIMESTAMP timest
     ts = uhd::time_spec_t::from_ticks(timestamp, rx_rate);
     SPDLOG_DEBUG("Requested timestamp = {}", ts.get_real_secs());
 
-    // Check that timestamp is valid
-    rc = rx_smpl_buf->avail_smpls(timestamp);
-    if (rc < 0) {
-        SPDLOG_ERROR("{}", rx_smpl_buf->str_code(rc)); // FIXME: What are these errors for?
-        SPDLOG_ERROR("{}", rx_smpl_buf->str_status()); // FIXME: What are these errors for?
-        return 0;
-    }
-
-    // Receive samples from the usrp until we have enough
-    while (rx_smpl_buf->avail_smpls(timestamp) < len) {
-        size_t num_smpls = rx_stream->recv((void *) pkt_buf, rx_spp, metadata, 0.1, true);
-        rx_pkt_cnt++;
-
-        // Check for errors
-        rc = check_rx_md_err(metadata, num_smpls);
-        switch (rc) {
-            case ERROR_UNRECOVERABLE:
-                SPDLOG_ERROR("UHD: Version {}", uhd::get_version_string());
-                SPDLOG_ERROR("UHD: Unrecoverable error, exiting...");
-                exit(-1); // FIXME: Why is there such a hard bailout here?
-            case ERROR_TIMING:
-                restart(prev_ts);
-            case ERROR_UNHANDLED:
-                continue;
-        }
-
-
-        ts = metadata.time_spec;
-        SPDLOG_DEBUG("Received timestamp = {}", ts.get_real_secs());
-        rc = rx_smpl_buf->write(pkt_buf, num_smpls, metadata.time_spec);
-        SPDLOG_DEBUG("After smpl_buf write");
-
-        // Continue on local overrun, exit on other errors
-        if ((rc < 0)) {
+    // Wait for the receive thread to buffer enough samples, the device is never touched here
+    rc = rx_smpl_buf->wait_smpls(timestamp, len);
+    if (rc < len) {
+        if (rc < 0) {
             SPDLOG_ERROR("{}", rx_smpl_buf->str_code(rc)); // FIXME: What are these errors for?
             SPDLOG_ERROR("{}", rx_smpl_buf->str_status()); // FIXME: What are these errors for?
-            if (rc != smpl_buf::ERROR_OVERFLOW)
-                return 0;
         }
+        return 0;
     }
 
-    SPDLOG_DEBUG("After while loop");
-
     // We have enough samples
     rc = rx_smpl_buf->read(buf, len, timestamp);
     SPDLOG_DEBUG("After smpl_buf read");
@@ -550,19 +572,55 @@ int uhd_device::readSamples(short *buf, int len, bool *overrun, TIMESTAMP timest
         return 0;
     }
 
+    // Report packets the receive thread dropped since the last read
+    *overrun = rx_overrun.exchange(false, std::memory_order_relaxed);
+
     SPDLOG_DEBUG("return len: {}", len);
     return len;
 }
 
+bool uhd_device::recv_rx_pkt() {
+    ssize_t rc;
+    uhd::rx_metadata_t metadata;
+    uint32_t pkt_buf[rx_spp];
+
+    if (!rx_running.load(std::memory_order_relaxed))
+        return false;
+
+    size_t num_smpls = rx_stream->recv((void *) pkt_buf, rx_spp, metadata, 0.1, true);
+    rx_pkt_cnt++;
+
+    // Check for errors
+    rc = check_rx_md_err(metadata, num_smpls);
+    switch (rc) {
+        case ERROR_UNRECOVERABLE:
+            SPDLOG_ERROR("UHD: Version {}", uhd::get_version_string());
+            SPDLOG_ERROR("UHD: Unrecoverable error, exiting...");
+            exit(-1); // FIXME: Why is there such a hard bailout here?
+        case ERROR_TIMING:
+            restart(prev_ts);
+            [[fallthrough]];
+        case ERROR_UNHANDLED:
+            return true;
+    }
+
+    SPDLOG_DEBUG("Received timestamp = {}", metadata.time_spec.get_real_secs());
+    rc = rx_smpl_buf->write(pkt_buf, num_smpls, metadata.time_spec);
+
+    // The reader fell a whole buffer behind, the packet is dropped and reads back as zeros
+    if (rc == smpl_buf::ERROR_OVERFLOW) {
+        if (!rx_overrun.exchange(true, std::memory_order_relaxed))
+            SPDLOG_ERROR("{}", rx_smpl_buf->str_code(rc));
+    } else if (rc < 0) {
+        SPDLOG_ERROR("{}", rx_smpl_buf->str_code(rc)); // FIXME: What are these errors for?
+        SPDLOG_ERROR("{}", rx_smpl_buf->str_status()); // FIXME: What are these errors for?
+    }
+
+    return true;
+}
+
 int uhd_device::writeSamples(short *buf, int len, bool *underrun, TIMESTAMP timestamp, bool isControl) {
     SPDLOG_DEBUG("writeSamaples");
-    uhd::tx_metadata_t metadata;
-    metadata.has_time_spec = true;
-    metadata.start_of_burst = false;
-    metadata.end_of_burst = false;
-    SPDLOG_DEBUG("Just before time_spec");
-    metadata.time_spec = uhd::time_spec_t::from_ticks(timestamp, tx_rate);
-
     *underrun = false;
 
     // No control packets
@@ -571,18 +629,63 @@ int uhd_device::writeSamples(short *buf, int len, bool *underrun, TIMESTAMP time
         return 0;
     }
 
+    // Queue for the transmit thread, the device is never touched here
+    ssize_t rc = tx_queue->write(buf, len, timestamp);
+
+    // Report drops and resynchronization by the transmit thread since the last write
+    *underrun = tx_underrun.exchange(false, std::memory_order_relaxed);
+
+    // A full queue means the transport is stalled, drop the samples but keep the timeline.
+    // Not an underrun, since transmitting further ahead would only fill the queue faster.
+    if (rc < 0) {
+        SPDLOG_ERROR("{}", tx_buf::str_code(rc));
+    }
+
+    return len;
+}
+
+bool uhd_device::send_tx_pkt() {
+    uhd::tx_metadata_t metadata;
+    metadata.has_time_spec = true;
+    metadata.start_of_burst = false;
+    metadata.end_of_burst = false;
+
+    if (!tx_running.load(std::memory_order_relaxed))
+        return false;
+
+    tx_buf::slot * slot = tx_queue->wait_front();
+    if (!slot)
+        return true;
+
+    metadata.time_spec = uhd::time_spec_t::from_ticks(slot->timestamp, tx_rate);
+
+    // Drop buffers that end before the newest received sample, they can only arrive late
+    if (!skip_rx && aligned) {
+        uhd::time_spec_t end = uhd::time_spec_t::from_ticks(slot->timestamp + slot->len, tx_rate);
+
+        if (end < uhd::time_spec_t::from_ticks(rx_smpl_buf->time_end(), rx_rate)) {
+            if (!tx_underrun.exchange(true, std::memory_order_relaxed))
+                SPDLOG_ERROR("UHD: Dropped late transmit buffer at {} sec., {} dropped in total",
+                             metadata.time_spec.get_real_secs(), tx_late_cnt + 1);
+            tx_late_cnt++;
+            tx_queue->pop();
+            return true;
+        }
+    }
+
     // Drop a fixed number of packets (magic value)
-    SPDLOG_DEBUG("aligned: {}, drop_cnt: {}", aligned, drop_cnt);
+    SPDLOG_DEBUG("aligned: {}, drop_cnt: {}", aligned.load(), drop_cnt);
     if (!aligned) {
         drop_cnt++;
 
         if (drop_cnt == 1) {
             SPDLOG_DEBUG("Aligning transmitter: stop burst");
-            *underrun = true;
+            tx_underrun = true;
             metadata.end_of_burst = true;
         } else if (drop_cnt < 30) {
             SPDLOG_DEBUG("Aligning transmitter: packet advance");
-            return len;
+            tx_queue->pop();
+            return true;
         } else {
             SPDLOG_DEBUG("Aligning transmitter: start burst");
             metadata.start_of_burst = true;
@@ -592,17 +695,18 @@ int uhd_device::writeSamples(short *buf, int len, bool *underrun, TIMESTAMP time
     }
 
     SPDLOG_DEBUG("about to tx_stream->send");
-    size_t num_smpls = tx_stream->send(buf, len, metadata);
+    size_t num_smpls = tx_stream->send(slot->data, slot->len, metadata);
     SPDLOG_DEBUG("num_smpls: {}", num_smpls);
 
-    if (num_smpls != (unsigned) len) {
-        SPDLOG_ERROR("UHD: Device send timed out");
-        SPDLOG_ERROR("UHD: Version {}", uhd::get_version_string());
-        SPDLOG_ERROR("UHD: Unrecoverable error, exiting...");
-        exit(-1); // FIXME: Why is there such a hard bailout here?
+    // A send timeout is recovered by realigning instead of exiting
+    if (num_smpls != slot->len) {
+        SPDLOG_ERROR("UHD: Device send timed out, realigning transmitter");
+        aligned = false;
+        tx_underrun = true;
     }
 
-    return num_smpls;
+    tx_queue->pop();
+    return true;
 }
 
 bool uhd_device::updateAlignment(TIMESTAMP timestamp) {
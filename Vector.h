@@ -194,6 +194,12 @@ public:
 
     bool isOwner() { return !!this->mData; }    // Do we own any memory ourselves?
 
+    /** Return the number of allocated elements before the start of the useful data, zero for aliases. */
+    [[nodiscard]] size_t headroom() const { return this->getData() ? mStart - this->getData() : 0; }
+
+    /** Return the number of allocated elements after the end of the useful data, zero for aliases. */
+    [[nodiscard]] size_t tailroom() const { return this->getData() ? mAllocEnd - mEnd : 0; }
+
     [[nodiscard]] std::string inspect() const {
         char buf[100];
         snprintf(buf, 100, " mData=%p mStart=%p mEnd=%p ", (void *) mData, mStart, mEnd);
@@ -292,12 +298,14 @@ protected:
     VectorDataType mData;        ///< allocated data block.
     T * mStart;        ///< start of useful data
     T * mEnd;        ///< end of useful data + 1
+    T * mAllocEnd;   ///< end of allocated data block, only meaningful when mData is set
 
     // Init vector with specified size.  Previous contents are completely discarded.  This is only used for initialization.
     void vInit(size_t elements) {
         mData = elements ? new T[elements] : NULL;
         mStart = mData;  // This is where mStart get set to zero
         mEnd = mStart + elements;
+        mAllocEnd = mEnd;
     }
 
     /** Assign from another Vector, shifting ownership. */
@@ -308,6 +316,7 @@ protected:
         this->mData = other.mData;
         this->mStart = other.mStart;
         this->mEnd = other.mEnd;
+        this->mAllocEnd = other.mAllocEnd;
         other.mData = NULL;
     }
 
@@ -321,10 +330,10 @@ protected:
         this->mEnd = const_cast<T *>(other.mEnd);
     }
 
-    VectorBase() : mData(0), mStart(0), mEnd(0) {}
+    VectorBase() : mData(0), mStart(0), mEnd(0), mAllocEnd(0) {}
 
     /** Build a Vector with explicit values. */
-    VectorBase(VectorDataType wData, T * wStart, T * wEnd) : mData(wData), mStart(wStart), mEnd(wEnd) {
+    VectorBase(VectorDataType wData, T * wStart, T * wEnd) : mData(wData), mStart(wStart), mEnd(wEnd), mAllocEnd(wEnd) {
         //VECTORDEBUG("VectorBase("<<(void*)wData);
         VECTORDEBUG("VectorBase(%p,%p,%p)", this->getData(), wStart, wEnd);
     }
@@ -339,7 +348,10 @@ public:
     explicit Vector(size_t wSize = 0) { this->resize(wSize); }
 
     /** Build a Vector by shifting the data block. */
-    Vector(Vector<T> &other) : VectorBase<T>(other.mData, other.mStart, other.mEnd) { other.mData = NULL; }
+    Vector(Vector<T> &other) : VectorBase<T>(other.mData, other.mStart, other.mEnd) {
+        this->mAllocEnd = other.mAllocEnd;
+        other.mData = NULL;
+    }
 
     /** Build a Vector by copying another. */
     Vector(const Vector<T> &other) : VectorBase<T>() { this->clone(other); }
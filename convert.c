@@ -1,5 +1,5 @@
 /*
- * SSE type conversions
+ * SIMD type conversions
  * Copyright (C) 2013 Thomas Tsou <tom@tsou.cc>
  *
  * This library is free software; you can redistribute it and/or
@@ -19,19 +19,91 @@
 
 #include <malloc.h>
 #include <string.h>
+#include <math.h>
 
 #ifdef HAVE_CONFIG_H
 #include "config.h"
 #endif
 
-#ifdef HAVE_SSE3
-#include <xmmintrin.h>
-#include <emmintrin.h>
+#include "convert.h"
+#include "simd.h"
 
-#ifdef HAVE_SSE4_1
-#include <smmintrin.h>
+/* Saturate a scaled sample to the 16-bit signed integer range */
+static inline short sat_si16(float val)
+{
+	if (val > 32767.0f)
+		return 32767;
+	if (val < -32768.0f)
+		return -32768;
+
+	return (short) lrintf(val);
+}
+
+/* Scaled and saturated single precision float to 16-bit conversion */
+static void convert_scale_ps_si16(short *out, float *in, float scale, int len)
+{
+	for (int i = 0; i < len; i++)
+		out[i] = sat_si16(in[i] * scale);
+}
+
+static void convert_si16_ps(float *out, short *in, int len)
+{
+	for (int i = 0; i < len; i++)
+		out[i] = in[i];
+}
+
+/*
+ * Transmit scale in Q15, unity (and above) is returned as zero. Scales just
+ * below unity round to 32768, which does not fit a 16-bit lane and would
+ * wrap to -1.0, so they are treated as unity too.
+ */
+static inline int scale_q15(float scale)
+{
+	int q;
+
+	if (scale >= 1.0f)
+		return 0;
+
+	q = (int) lrintf(scale * 32768.0f);
+
+	return (q >= 32768) ? 0 : q;
+}
+
+/*
+ * Scaled and saturated 16-bit accumulate. The scale is applied as a rounded
+ * Q15 multiply, which matches the pmulhrsw instruction of the vector kernel.
+ */
+static void add_scale_si16(short *out, const short *in, float scale, int len)
+{
+	int q = scale_q15(scale);
+
+	for (int i = 0; i < len; i++) {
+		int val = q ? (in[i] * q + 0x4000) >> 15 : in[i];
+
+		val += out[i];
+		out[i] = val > 32767 ? 32767 : (val < -32768 ? -32768 : val);
+	}
+}
+
+/*
+ * Interleaved I/Q conversion with DC offset removal. The offset is
+ * subtracted from each rail and the rail sums (prior to removal) are
+ * accumulated so the caller can track the offset without a second pass.
+ */
+static void convert_si16_ps_dc(float *out, short *in, const float *dc,
+			       float *sum, int len)
+{
+	for (int i = 0; i < len; i++) {
+		sum[i & 1] += in[i];
+		out[i] = in[i] - dc[i & 1];
+	}
+}
+
+#ifdef HAVE_SIMD_X86
+#include <immintrin.h>
 
 /* 16*N 16-bit signed integer converted to single precision floats */
+SIMD_TARGET("sse4.1")
 static void _sse_convert_si16_ps_16n(float *restrict out,
 				     short *restrict in,
 				     int len)
@@ -67,6 +139,7 @@ static void _sse_convert_si16_ps_16n(float *restrict out,
 }
 
 /* 16*N 16-bit signed integer conversion with remainder */
+SIMD_TARGET("sse4.1")
 static void _sse_convert_si16_ps(float *restrict out,
 				 short *restrict in,
 				 int len)
@@ -78,16 +151,18 @@ static void _sse_convert_si16_ps(float *restrict out,
 	for (int i = 0; i < len % 16; i++)
 		out[start + i] = in[start + i];
 }
-#endif /* HAVE_SSE4_1 */
-
 /* 8*N single precision floats scaled and converted to 16-bit signed integer */
+SIMD_TARGET("sse3")
 static void _sse_convert_scale_ps_si16_8n(short *restrict out,
 					  float *restrict in,
 					  float scale, int len)
 {
-	__m128 m0, m1, m2;
+	__m128 m0, m1, m2, m3;
 	__m128i m4, m5;
 
+	/* Clamp before conversion, out of range converts to INT_MIN */
+	m3 = _mm_set1_ps(32767.0f);
+
 	for (int i = 0; i < len / 8; i++) {
 		/* Load (unaligned) packed floats */
 		m0 = _mm_loadu_ps(&in[8 * i + 0]);
@@ -95,8 +170,8 @@ static void _sse_convert_scale_ps_si16_8n(short *restrict out,
 		m2 = _mm_load1_ps(&scale);
 
 		/* Scale */
-		m0 = _mm_mul_ps(m0, m2);
-		m1 = _mm_mul_ps(m1, m2);
+		m0 = _mm_min_ps(_mm_mul_ps(m0, m2), m3);
+		m1 = _mm_min_ps(_mm_mul_ps(m1, m2), m3);
 
 		/* Convert */
 		m4 = _mm_cvtps_epi32(m0);
@@ -109,6 +184,7 @@ static void _sse_convert_scale_ps_si16_8n(short *restrict out,
 }
 
 /* 8*N single precision floats scaled and converted with remainder */
+SIMD_TARGET("sse3")
 static void _sse_convert_scale_ps_si16(short *restrict out,
 				       float *restrict in,
 				       float scale, int len)
@@ -118,17 +194,20 @@ static void _sse_convert_scale_ps_si16(short *restrict out,
 	_sse_convert_scale_ps_si16_8n(out, in, scale, len);
 
 	for (int i = 0; i < len % 8; i++)
-		out[start + i] = in[start + i] * scale;
+		out[start + i] = sat_si16(in[start + i] * scale);
 }
 
 /* 16*N single precision floats scaled and converted to 16-bit signed integer */
+SIMD_TARGET("sse3")
 static void _sse_convert_scale_ps_si16_16n(short *restrict out,
 					   float *restrict in,
 					   float scale, int len)
 {
-	__m128 m0, m1, m2, m3, m4;
+	__m128 m0, m1, m2, m3, m4, m9;
 	__m128i m5, m6, m7, m8;
 
+	m9 = _mm_set1_ps(32767.0f);
+
 	for (int i = 0; i < len / 16; i++) {
 		/* Load (unaligned) packed floats */
 		m0 = _mm_loadu_ps(&in[16 * i + 0]);
@@ -138,10 +217,10 @@ static void _sse_convert_scale_ps_si16_16n(short *restrict out,
 		m4 = _mm_load1_ps(&scale);
 
 		/* Scale */
-		m0 = _mm_mul_ps(m0, m4);
-		m1 = _mm_mul_ps(m1, m4);
-		m2 = _mm_mul_ps(m2, m4);
-		m3 = _mm_mul_ps(m3, m4);
+		m0 = _mm_min_ps(_mm_mul_ps(m0, m4), m9);
+		m1 = _mm_min_ps(_mm_mul_ps(m1, m4), m9);
+		m2 = _mm_min_ps(_mm_mul_ps(m2, m4), m9);
+		m3 = _mm_min_ps(_mm_mul_ps(m3, m4), m9);
 
 		/* Convert */
 		m5 = _mm_cvtps_epi32(m0);
@@ -156,44 +235,322 @@ static void _sse_convert_scale_ps_si16_16n(short *restrict out,
 		_mm_storeu_si128((__m128i *) &out[16 * i + 8], m7);
 	}
 }
-#else /* HAVE_SSE3 */
-static void convert_scale_ps_si16(short *out, float *in, float scale, int len)
+
+SIMD_TARGET("sse3")
+static void sse_convert_scale_ps_si16(short *out, float *in,
+				      float scale, int len)
 {
-	for (int i = 0; i < len; i++)
-		out[i] = in[i] * scale;
+	if (!(len % 16))
+		_sse_convert_scale_ps_si16_16n(out, in, scale, len);
+	else
+		_sse_convert_scale_ps_si16(out, in, scale, len);
 }
-#endif
 
-#ifndef HAVE_SSE4_1
-static void convert_si16_ps(float *out, short *in, int len)
+SIMD_TARGET("sse4.1")
+static void sse_convert_si16_ps(float *out, short *in, int len)
 {
-	for (int i = 0; i < len; i++)
-		out[i] = in[i];
+	if (!(len % 16))
+		_sse_convert_si16_ps_16n(out, in, len);
+	else
+		_sse_convert_si16_ps(out, in, len);
+}
+
+/* AVX2 scaled float to 16-bit conversion with saturating pack */
+SIMD_TARGET("avx2")
+static void avx2_convert_scale_ps_si16(short *restrict out,
+				       float *restrict in,
+				       float scale, int len)
+{
+	__m256 m0, m1, m2, m5;
+	__m256i m3, m4;
+	int start = len / 16 * 16;
+
+	m2 = _mm256_set1_ps(scale);
+	m5 = _mm256_set1_ps(32767.0f);
+
+	for (int i = 0; i < start; i += 16) {
+		m0 = _mm256_mul_ps(_mm256_loadu_ps(&in[i + 0]), m2);
+		m1 = _mm256_mul_ps(_mm256_loadu_ps(&in[i + 8]), m2);
+		m0 = _mm256_min_ps(m0, m5);
+		m1 = _mm256_min_ps(m1, m5);
+
+		m3 = _mm256_cvtps_epi32(m0);
+		m4 = _mm256_cvtps_epi32(m1);
+
+		/* Pack within 128-bit lanes, then restore sample order */
+		m3 = _mm256_packs_epi32(m3, m4);
+		m3 = _mm256_permute4x64_epi64(m3, _MM_SHUFFLE(3, 1, 2, 0));
+
+		_mm256_storeu_si256((__m256i *) &out[i], m3);
+	}
+
+	convert_scale_ps_si16(&out[start], &in[start], scale, len - start);
+}
+
+/* AVX2 16-bit to float conversion */
+SIMD_TARGET("avx2")
+static void avx2_convert_si16_ps(float *restrict out,
+				 short *restrict in,
+				 int len)
+{
+	__m256i m0, m1;
+	int start = len / 16 * 16;
+
+	for (int i = 0; i < start; i += 16) {
+		m0 = _mm256_cvtepi16_epi32(_mm_loadu_si128((__m128i *) &in[i + 0]));
+		m1 = _mm256_cvtepi16_epi32(_mm_loadu_si128((__m128i *) &in[i + 8]));
+
+		_mm256_storeu_ps(&out[i + 0], _mm256_cvtepi32_ps(m0));
+		_mm256_storeu_ps(&out[i + 8], _mm256_cvtepi32_ps(m1));
+	}
+
+	convert_si16_ps(&out[start], &in[start], len - start);
 }
+
+/* AVX2 scaled 16-bit accumulate with saturating add */
+SIMD_TARGET("avx2")
+static void avx2_add_scale_si16(short *restrict out,
+				const short *restrict in,
+				float scale, int len)
+{
+	__m256i m0, m1, m2;
+	int q = scale_q15(scale);
+	int start = len / 16 * 16;
+
+	m2 = _mm256_set1_epi16(q);
+
+	for (int i = 0; i < start; i += 16) {
+		m0 = _mm256_loadu_si256((__m256i *) &in[i]);
+		m1 = _mm256_loadu_si256((__m256i *) &out[i]);
+
+		if (q)
+			m0 = _mm256_mulhrs_epi16(m0, m2);
+
+		_mm256_storeu_si256((__m256i *) &out[i],
+				    _mm256_adds_epi16(m1, m0));
+	}
+
+	add_scale_si16(&out[start], &in[start], scale, len - start);
+}
+
+/* Sum even (I) and odd (Q) lanes of a vector into the rail sums */
+SIMD_TARGET("avx")
+static inline void avx_add_rails(float *sum, __m256 m0)
+{
+	__m128 m1;
+
+	m1 = _mm_add_ps(_mm256_castps256_ps128(m0),
+			_mm256_extractf128_ps(m0, 1));
+	m1 = _mm_add_ps(m1, _mm_movehl_ps(m1, m1));
+
+	sum[0] += _mm_cvtss_f32(m1);
+	sum[1] += _mm_cvtss_f32(_mm_shuffle_ps(m1, m1, _MM_SHUFFLE(1, 1, 1, 1)));
+}
+
+/* AVX2 16-bit to float conversion with DC offset removal */
+SIMD_TARGET("avx2")
+static void avx2_convert_si16_ps_dc(float *restrict out,
+				    short *restrict in,
+				    const float *dc, float *sum, int len)
+{
+	__m256 m0, m1, m2, m3, m4;
+	int start = len / 16 * 16;
+
+	m2 = _mm256_setr_ps(dc[0], dc[1], dc[0], dc[1],
+			    dc[0], dc[1], dc[0], dc[1]);
+	m3 = _mm256_setzero_ps();
+	m4 = _mm256_setzero_ps();
+
+	for (int i = 0; i < start; i += 16) {
+		m0 = _mm256_cvtepi32_ps(_mm256_cvtepi16_epi32(
+			_mm_loadu_si128((__m128i *) &in[i + 0])));
+		m1 = _mm256_cvtepi32_ps(_mm256_cvtepi16_epi32(
+			_mm_loadu_si128((__m128i *) &in[i + 8])));
+
+		m3 = _mm256_add_ps(m3, m0);
+		m4 = _mm256_add_ps(m4, m1);
+
+		_mm256_storeu_ps(&out[i + 0], _mm256_sub_ps(m0, m2));
+		_mm256_storeu_ps(&out[i + 8], _mm256_sub_ps(m1, m2));
+	}
+
+	avx_add_rails(sum, _mm256_add_ps(m3, m4));
+
+	convert_si16_ps_dc(&out[start], &in[start], dc, sum, len - start);
+}
+
+/* AVX-512 scaled float to 16-bit conversion with saturating narrow */
+SIMD_TARGET("avx512f")
+static void avx512_convert_scale_ps_si16(short *restrict out,
+					 float *restrict in,
+					 float scale, int len)
+{
+	__m512 m0, m1, m2, m3;
+	int start = len / 32 * 32;
+
+	m2 = _mm512_set1_ps(scale);
+	m3 = _mm512_set1_ps(32767.0f);
+
+	for (int i = 0; i < start; i += 32) {
+		m0 = _mm512_min_ps(_mm512_mul_ps(_mm512_loadu_ps(&in[i + 0]), m2), m3);
+		m1 = _mm512_min_ps(_mm512_mul_ps(_mm512_loadu_ps(&in[i + 16]), m2), m3);
+
+		_mm256_storeu_si256((__m256i *) &out[i + 0],
+				    _mm512_cvtsepi32_epi16(_mm512_cvtps_epi32(m0)));
+		_mm256_storeu_si256((__m256i *) &out[i + 16],
+				    _mm512_cvtsepi32_epi16(_mm512_cvtps_epi32(m1)));
+	}
+
+	convert_scale_ps_si16(&out[start], &in[start], scale, len - start);
+}
+
+/* AVX-512 16-bit to float conversion */
+SIMD_TARGET("avx512f")
+static void avx512_convert_si16_ps(float *restrict out,
+				   short *restrict in,
+				   int len)
+{
+	__m512i m0, m1;
+	int start = len / 32 * 32;
+
+	for (int i = 0; i < start; i += 32) {
+		m0 = _mm512_cvtepi16_epi32(_mm256_loadu_si256((__m256i *) &in[i + 0]));
+		m1 = _mm512_cvtepi16_epi32(_mm256_loadu_si256((__m256i *) &in[i + 16]));
+
+		_mm512_storeu_ps(&out[i + 0], _mm512_cvtepi32_ps(m0));
+		_mm512_storeu_ps(&out[i + 16], _mm512_cvtepi32_ps(m1));
+	}
+
+	convert_si16_ps(&out[start], &in[start], len - start);
+}
+
+/* AVX-512 16-bit to float conversion with DC offset removal */
+SIMD_TARGET("avx512f")
+static void avx512_convert_si16_ps_dc(float *restrict out,
+				      short *restrict in,
+				      const float *dc, float *sum, int len)
+{
+	__m512 m0, m1, m2, m3, m4;
+	int start = len / 32 * 32;
+
+	m2 = _mm512_mask_mov_ps(_mm512_set1_ps(dc[1]), 0x5555,
+				_mm512_set1_ps(dc[0]));
+	m3 = _mm512_setzero_ps();
+	m4 = _mm512_setzero_ps();
+
+	for (int i = 0; i < start; i += 32) {
+		m0 = _mm512_cvtepi32_ps(_mm512_cvtepi16_epi32(
+			_mm256_loadu_si256((__m256i *) &in[i + 0])));
+		m1 = _mm512_cvtepi32_ps(_mm512_cvtepi16_epi32(
+			_mm256_loadu_si256((__m256i *) &in[i + 16])));
+
+		m3 = _mm512_add_ps(m3, m0);
+		m4 = _mm512_add_ps(m4, m1);
+
+		_mm512_storeu_ps(&out[i + 0], _mm512_sub_ps(m0, m2));
+		_mm512_storeu_ps(&out[i + 16], _mm512_sub_ps(m1, m2));
+	}
+
+	m3 = _mm512_add_ps(m3, m4);
+	avx_add_rails(sum, _mm256_add_ps(_mm512_castps512_ps256(m3),
+		_mm256_castpd_ps(_mm512_extractf64x4_pd(_mm512_castps_pd(m3), 1))));
+
+	convert_si16_ps_dc(&out[start], &in[start], dc, sum, len - start);
+}
+#endif /* HAVE_SIMD_X86 */
+
+/*
+ * Conversion kernel registry, ordered from widest to narrowest instruction
+ * set. Missing entries fall back to the generic implementation.
+ */
+struct convert_backend {
+	const char *name;
+	int flags;
+	void (*scale_ps_si16)(short *out, float *in, float scale, int len);
+	void (*si16_ps)(float *out, short *in, int len);
+	void (*si16_ps_dc)(float *out, short *in, const float *dc,
+			   float *sum, int len);
+	void (*add_scale_si16)(short *out, const short *in, float scale,
+			       int len);
+};
+
+static const struct convert_backend convert_backends[] = {
+#ifdef HAVE_SIMD_X86
+	{ "AVX-512", SIMD_AVX512, avx512_convert_scale_ps_si16,
+	  avx512_convert_si16_ps, avx512_convert_si16_ps_dc,
+	  avx2_add_scale_si16 },
+	{ "AVX2", SIMD_AVX2, avx2_convert_scale_ps_si16,
+	  avx2_convert_si16_ps, avx2_convert_si16_ps_dc,
+	  avx2_add_scale_si16 },
+	{ "SSE4.1", SIMD_SSE3 | SIMD_SSE4_1, sse_convert_scale_ps_si16,
+	  sse_convert_si16_ps, NULL, NULL },
+	{ "SSE3", SIMD_SSE3, sse_convert_scale_ps_si16,
+	  NULL, NULL, NULL },
 #endif
+	{ "generic", 0, NULL, NULL, NULL, NULL },
+};
+
+#define NUM_CONVERT_BACKENDS \
+	(sizeof(convert_backends) / sizeof(convert_backends[0]))
+
+static const struct convert_backend *convert_backend =
+	&convert_backends[NUM_CONVERT_BACKENDS - 1];
+
+const char *convert_init(void)
+{
+	int flags = simd_probe();
+
+	for (size_t i = 0; i < NUM_CONVERT_BACKENDS; i++) {
+		if ((convert_backends[i].flags & flags) == convert_backends[i].flags) {
+			convert_backend = &convert_backends[i];
+			break;
+		}
+	}
+
+	return convert_backend->name;
+}
 
 void convert_float_short(short *out, float *in, float scale, int len)
 {
-#ifdef HAVE_SSE3
-	if (!(len % 16))
-		_sse_convert_scale_ps_si16_16n(out, in, scale, len);
-	else if (!(len % 8))
-		_sse_convert_scale_ps_si16_8n(out, in, scale, len);
+	if (convert_backend->scale_ps_si16)
+		convert_backend->scale_ps_si16(out, in, scale, len);
 	else
-		_sse_convert_scale_ps_si16(out, in, scale, len);
-#else
-	convert_scale_ps_si16(out, in, scale, len);
-#endif
+		convert_scale_ps_si16(out, in, scale, len);
 }
 
 void convert_short_float(float *out, short *in, int len)
 {
-#ifdef HAVE_SSE4_1
-	if (!(len % 16))
-		_sse_convert_si16_ps_16n(out, in, len);
+	if (convert_backend->si16_ps)
+		convert_backend->si16_ps(out, in, len);
 	else
-		_sse_convert_si16_ps(out, in, len);
-#else
-	convert_si16_ps(out, in, len);
-#endif
+		convert_si16_ps(out, in, len);
+}
+
+void convert_short_float_dc(float *out, short *in, const float *dc,
+			    float *mean, int len)
+{
+	float sum[2] = { 0.0f, 0.0f };
+
+	if (convert_backend->si16_ps_dc)
+		convert_backend->si16_ps_dc(out, in, dc, sum, len);
+	else
+		convert_si16_ps_dc(out, in, dc, sum, len);
+
+	/* No complete sample, report the offset itself so estimates hold */
+	if (len / 2 == 0) {
+		mean[0] = dc[0];
+		mean[1] = dc[1];
+		return;
+	}
+
+	mean[0] = sum[0] / (len / 2);
+	mean[1] = sum[1] / (len / 2);
+}
+
+void convert_short_add(short *out, const short *in, float scale, int len)
+{
+	if (convert_backend->add_scale_si16)
+		convert_backend->add_scale_si16(out, in, scale, len);
+	else
+		add_scale_si16(out, in, scale, len);
 }
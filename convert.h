@@ -1,7 +1,22 @@
 #ifndef _CONVERT_H_
 #define _CONVERT_H_
 
+/* Select the widest conversion kernels supported by the CPU, returns name */
+const char *convert_init(void);
+
+/* Scaled float to 16-bit conversion, saturates at the 16-bit limits */
 void convert_float_short(short *out, float *in, float scale, int len);
 void convert_short_float(float *out, short *in, int len);
 
+/* Scaled 16-bit accumulate, out += in * scale, saturates at the 16-bit limits */
+void convert_short_add(short *out, const short *in, float scale, int len);
+
+/*
+ * 16-bit to float conversion of interleaved I/Q with the (I, Q) offset in
+ * dc subtracted. The per-rail block mean before removal is written to mean,
+ * or dc itself when len holds no complete sample.
+ */
+void convert_short_float_dc(float *out, short *in, const float *dc,
+			    float *mean, int len);
+
 #endif /* _CONVERT_H_ */
@@ -1,5 +1,5 @@
 /*
- * SSE Convolution
+ * SIMD Convolution
  * Copyright (C) 2012, 2013 Thomas Tsou <tom@tsou.cc>
  *
  * This library is free software; you can redistribute it and/or
@@ -20,16 +20,68 @@
 #include <malloc.h>
 #include <string.h>
 #include <stdio.h>
+#include <math.h>
 
 #ifdef HAVE_CONFIG_H
 #include "config.h"
 #endif
 
-#ifdef HAVE_SSE3
-#include <xmmintrin.h>
-#include <pmmintrin.h>
+#include "convolve.h"
+#include "simd.h"
+
+/* Filter tap alignment, sufficient for all vector widths */
+#define CONV_ALIGN		64
+
+/* Largest number and length of tap sets for the batched detector */
+#define CONV_MULTI_MAX		8
+#define CONV_MULTI_TAPS		32
+
+/*
+ * Rotate and scale a demodulated symbol, then slice the real part from
+ * [-1, 1] onto a soft bit in [0, 255], rounding to nearest
+ */
+static inline unsigned char soft_bit(const float *y, const float *r,
+				     const float *s)
+{
+	float c_re = r[0] * s[0] - r[1] * s[1];
+	float c_im = r[0] * s[1] + r[1] * s[0];
+	float v = (y[0] * c_re - y[1] * c_im + 1.0f) * 127.5f;
+
+	if (v <= 0.0f)
+		return 0;
+	if (v >= 255.0f)
+		return 255;
+
+	return (unsigned char) (v + 0.5f);
+}
+
+/* Track the correlation output of largest power, keeping the first on ties */
+static inline void track_peak(const float *y, int i, float *max, int *index)
+{
+	float pwr = y[0] * y[0] + y[1] * y[1];
+
+	if (pwr > *max) {
+		*max = pwr;
+		*index = i;
+	}
+}
+
+/* Base clipping check over len interleaved values */
+static int base_clipped(const float *x, int len, float clip)
+{
+	for (int i = 0; i < len; i++) {
+		if (fabsf(x[i]) > clip)
+			return 1;
+	}
+
+	return 0;
+}
+
+#ifdef HAVE_SIMD_X86
+#include <immintrin.h>
 
 /* 4-tap SSE complex-real convolution */
+SIMD_TARGET("sse3")
 static void sse_conv_real4(float *restrict x,
 			   float *restrict h,
 			   float *restrict y,
@@ -64,6 +116,7 @@ static void sse_conv_real4(float *restrict x,
 }
 
 /* 8-tap SSE complex-real convolution */
+SIMD_TARGET("sse3")
 static void sse_conv_real8(float *restrict x,
 			   float *restrict h,
 			   float *restrict y,
@@ -111,6 +164,7 @@ static void sse_conv_real8(float *restrict x,
 }
 
 /* 12-tap SSE complex-real convolution */
+SIMD_TARGET("sse3")
 static void sse_conv_real12(float *restrict x,
 			    float *restrict h,
 			    float *restrict y,
@@ -173,6 +227,7 @@ static void sse_conv_real12(float *restrict x,
 }
 
 /* 16-tap SSE complex-real convolution */
+SIMD_TARGET("sse3")
 static void sse_conv_real16(float *restrict x,
 			    float *restrict h,
 			    float *restrict y,
@@ -248,6 +303,7 @@ static void sse_conv_real16(float *restrict x,
 }
 
 /* 20-tap SSE complex-real convolution */
+SIMD_TARGET("sse3")
 static void sse_conv_real20(float *restrict x,
 			    float *restrict h,
 			    float *restrict y,
@@ -334,6 +390,7 @@ static void sse_conv_real20(float *restrict x,
 }
 
 /* 4*N-tap SSE complex-real convolution */
+SIMD_TARGET("sse3")
 static void sse_conv_real4n(float *x, float *h, float *y, int h_len, int len)
 {
 	__m128 m0, m1, m2, m4, m5, m6, m7;
@@ -374,6 +431,7 @@ static void sse_conv_real4n(float *x, float *h, float *y, int h_len, int len)
 }
 
 /* 4*N-tap SSE complex-complex convolution */
+SIMD_TARGET("sse3")
 static void sse_conv_cmplx_4n(float *x, float *h, float *y, int h_len, int len)
 {
 	__m128 m0, m1, m2, m3, m4, m5, m6, m7;
@@ -422,6 +480,7 @@ static void sse_conv_cmplx_4n(float *x, float *h, float *y, int h_len, int len)
 }
 
 /* 8*N-tap SSE complex-complex convolution */
+SIMD_TARGET("sse3")
 static void sse_conv_cmplx_8n(float *x, float *h, float *y, int h_len, int len)
 {
 	__m128 m0, m1, m2, m3, m4, m5, m6, m7;
@@ -491,7 +550,538 @@ static void sse_conv_cmplx_8n(float *x, float *h, float *y, int h_len, int len)
 		_mm_store_ss(&y[2 * i + 1], m2);
 	}
 }
-#endif
+
+/* SSE complex-real dispatch, multiples of 4 taps only */
+static int sse_conv_real(float *x, float *h, float *y, int h_len, int len)
+{
+	switch (h_len) {
+	case 4:
+		sse_conv_real4(x, h, y, len);
+		break;
+	case 8:
+		sse_conv_real8(x, h, y, len);
+		break;
+	case 12:
+		sse_conv_real12(x, h, y, len);
+		break;
+	case 16:
+		sse_conv_real16(x, h, y, len);
+		break;
+	case 20:
+		sse_conv_real20(x, h, y, len);
+		break;
+	default:
+		if (h_len % 4)
+			return -1;
+		sse_conv_real4n(x, h, y, h_len, len);
+	}
+
+	return 0;
+}
+
+/* SSE complex-complex dispatch, multiples of 4 taps only */
+static int sse_conv_cmplx(float *x, float *h, float *y, int h_len, int len)
+{
+	if (!(h_len % 8))
+		sse_conv_cmplx_8n(x, h, y, h_len, len);
+	else if (!(h_len % 4))
+		sse_conv_cmplx_4n(x, h, y, h_len, len);
+	else
+		return -1;
+
+	return 0;
+}
+
+/* Sum the 4 interleaved complex values of a vector and store the result */
+SIMD_TARGET("avx")
+static inline void avx_store_csum(float *y, __m256 m0)
+{
+	__m128 m1, m2;
+
+	m1 = _mm256_castps256_ps128(m0);
+	m2 = _mm256_extractf128_ps(m0, 1);
+	m1 = _mm_add_ps(m1, m2);
+	m2 = _mm_movehl_ps(m1, m1);
+	m1 = _mm_add_ps(m1, m2);
+
+	_mm_storel_pi((__m64 *) y, m1);
+}
+
+/* Load mask covering the complex tap remainder of an AVX block */
+SIMD_TARGET("avx2")
+static inline __m256i avx2_tail_mask(int h_len)
+{
+	return _mm256_cmpgt_epi32(_mm256_set1_epi32(2 * (h_len % 4)),
+				  _mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7));
+}
+
+/* AVX2/FMA complex-real dot product of h_len taps, unreduced */
+SIMD_TARGET("avx2,fma")
+static inline __m256 avx2_dot_real(const float *x, const float *h,
+				   int h_len, __m256i mask)
+{
+	__m256 m0, m1, m2, m3, m4, m5;
+	int n, tail = h_len / 4 * 4;
+
+	m4 = _mm256_setzero_ps();
+	m5 = _mm256_setzero_ps();
+
+	/* Real taps are duplicated across each complex input sample */
+	for (n = 0; n + 8 <= h_len; n += 8) {
+		m0 = _mm256_moveldup_ps(_mm256_loadu_ps(&h[2 * n + 0]));
+		m1 = _mm256_moveldup_ps(_mm256_loadu_ps(&h[2 * n + 8]));
+		m2 = _mm256_loadu_ps(&x[2 * n + 0]);
+		m3 = _mm256_loadu_ps(&x[2 * n + 8]);
+
+		m4 = _mm256_fmadd_ps(m2, m0, m4);
+		m5 = _mm256_fmadd_ps(m3, m1, m5);
+	}
+
+	if (n < tail) {
+		m0 = _mm256_moveldup_ps(_mm256_loadu_ps(&h[2 * n]));
+		m2 = _mm256_loadu_ps(&x[2 * n]);
+		m4 = _mm256_fmadd_ps(m2, m0, m4);
+	}
+
+	if (tail < h_len) {
+		m0 = _mm256_moveldup_ps(_mm256_maskload_ps(&h[2 * tail], mask));
+		m2 = _mm256_maskload_ps(&x[2 * tail], mask);
+		m5 = _mm256_fmadd_ps(m2, m0, m5);
+	}
+
+	return _mm256_add_ps(m4, m5);
+}
+
+/* N-tap AVX2/FMA complex-real convolution */
+SIMD_TARGET("avx2,fma")
+static int avx2_conv_real(float *x, float *h, float *y, int h_len, int len)
+{
+	__m256i mask = avx2_tail_mask(h_len);
+
+	for (int i = 0; i < len; i++)
+		avx_store_csum(&y[2 * i], avx2_dot_real(&x[2 * i], h, h_len, mask));
+
+	return 0;
+}
+
+/* AVX2/FMA complex-complex dot product of h_len taps, unreduced */
+SIMD_TARGET("avx2,fma")
+static inline __m256 avx2_dot_cmplx(const float *x, const float *h,
+				    int h_len, __m256i mask)
+{
+	__m256 m0, m1, m2, m3, m4, m5;
+	int n, tail = h_len / 4 * 4;
+
+	m4 = _mm256_setzero_ps();
+	m5 = _mm256_setzero_ps();
+
+	/*
+	 * Accumulate (xr * hr, xi * hr) and (xi * hi, xr * hi)
+	 * separately and combine with a single add-subtract.
+	 */
+	for (n = 0; n < tail; n += 4) {
+		m0 = _mm256_loadu_ps(&h[2 * n]);
+		m1 = _mm256_moveldup_ps(m0);
+		m0 = _mm256_movehdup_ps(m0);
+
+		m2 = _mm256_loadu_ps(&x[2 * n]);
+		m3 = _mm256_permute_ps(m2, _MM_SHUFFLE(2, 3, 0, 1));
+
+		m4 = _mm256_fmadd_ps(m2, m1, m4);
+		m5 = _mm256_fmadd_ps(m3, m0, m5);
+	}
+
+	if (tail < h_len) {
+		m0 = _mm256_maskload_ps(&h[2 * tail], mask);
+		m1 = _mm256_moveldup_ps(m0);
+		m0 = _mm256_movehdup_ps(m0);
+
+		m2 = _mm256_maskload_ps(&x[2 * tail], mask);
+		m3 = _mm256_permute_ps(m2, _MM_SHUFFLE(2, 3, 0, 1));
+
+		m4 = _mm256_fmadd_ps(m2, m1, m4);
+		m5 = _mm256_fmadd_ps(m3, m0, m5);
+	}
+
+	return _mm256_addsub_ps(m4, m5);
+}
+
+/* N-tap AVX2/FMA complex-complex convolution */
+SIMD_TARGET("avx2,fma")
+static int avx2_conv_cmplx(float *x, float *h, float *y, int h_len, int len)
+{
+	__m256i mask = avx2_tail_mask(h_len);
+
+	for (int i = 0; i < len; i++)
+		avx_store_csum(&y[2 * i], avx2_dot_cmplx(&x[2 * i], h, h_len, mask));
+
+	return 0;
+}
+
+/* Fold a 512-bit accumulator into 256 bits */
+SIMD_TARGET("avx512f")
+static inline __m256 avx512_fold(__m512 m0)
+{
+	__m256 m1, m2;
+
+	m1 = _mm512_castps512_ps256(m0);
+	m2 = _mm256_castpd_ps(_mm512_extractf64x4_pd(_mm512_castps_pd(m0), 1));
+
+	return _mm256_add_ps(m1, m2);
+}
+
+/* AVX-512 complex-real dot product of h_len taps, unreduced */
+SIMD_TARGET("avx512f,avx2,fma")
+static inline __m512 avx512_dot_real(const float *x, const float *h,
+				     int h_len, __mmask16 mask)
+{
+	__m512 m0, m1, m2, m3, m4, m5;
+	int n, tail = h_len / 8 * 8;
+
+	m4 = _mm512_setzero_ps();
+	m5 = _mm512_setzero_ps();
+
+	for (n = 0; n + 16 <= h_len; n += 16) {
+		m0 = _mm512_moveldup_ps(_mm512_loadu_ps(&h[2 * n + 0]));
+		m1 = _mm512_moveldup_ps(_mm512_loadu_ps(&h[2 * n + 16]));
+		m2 = _mm512_loadu_ps(&x[2 * n + 0]);
+		m3 = _mm512_loadu_ps(&x[2 * n + 16]);
+
+		m4 = _mm512_fmadd_ps(m2, m0, m4);
+		m5 = _mm512_fmadd_ps(m3, m1, m5);
+	}
+
+	if (n < tail) {
+		m0 = _mm512_moveldup_ps(_mm512_loadu_ps(&h[2 * n]));
+		m2 = _mm512_loadu_ps(&x[2 * n]);
+		m4 = _mm512_fmadd_ps(m2, m0, m4);
+	}
+
+	if (tail < h_len) {
+		m0 = _mm512_moveldup_ps(_mm512_maskz_loadu_ps(mask, &h[2 * tail]));
+		m2 = _mm512_maskz_loadu_ps(mask, &x[2 * tail]);
+		m5 = _mm512_fmadd_ps(m2, m0, m5);
+	}
+
+	return _mm512_add_ps(m4, m5);
+}
+
+/* N-tap AVX-512 complex-real convolution */
+SIMD_TARGET("avx512f,avx2,fma")
+static int avx512_conv_real(float *x, float *h, float *y, int h_len, int len)
+{
+	__mmask16 mask = (1 << (2 * (h_len % 8))) - 1;
+
+	for (int i = 0; i < len; i++) {
+		avx_store_csum(&y[2 * i],
+			       avx512_fold(avx512_dot_real(&x[2 * i], h,
+							   h_len, mask)));
+	}
+
+	return 0;
+}
+
+/* AVX-512 complex-complex dot product of h_len taps, folded to 256 bits */
+SIMD_TARGET("avx512f,avx2,fma")
+static inline __m256 avx512_dot_cmplx(const float *x, const float *h,
+				      int h_len, __mmask16 mask)
+{
+	__m512 m0, m1, m2, m3, m4, m5;
+	int n, tail = h_len / 8 * 8;
+
+	m4 = _mm512_setzero_ps();
+	m5 = _mm512_setzero_ps();
+
+	for (n = 0; n < h_len; n += 8) {
+		if (n < tail) {
+			m0 = _mm512_loadu_ps(&h[2 * n]);
+			m2 = _mm512_loadu_ps(&x[2 * n]);
+		} else {
+			m0 = _mm512_maskz_loadu_ps(mask, &h[2 * n]);
+			m2 = _mm512_maskz_loadu_ps(mask, &x[2 * n]);
+		}
+
+		m1 = _mm512_moveldup_ps(m0);
+		m0 = _mm512_movehdup_ps(m0);
+		m3 = _mm512_permute_ps(m2, _MM_SHUFFLE(2, 3, 0, 1));
+
+		m4 = _mm512_fmadd_ps(m2, m1, m4);
+		m5 = _mm512_fmadd_ps(m3, m0, m5);
+	}
+
+	/* Subtract on real (even) lanes, add on imaginary (odd) lanes */
+	m4 = _mm512_mask_sub_ps(_mm512_add_ps(m4, m5), 0x5555, m4, m5);
+
+	return avx512_fold(m4);
+}
+
+/* N-tap AVX-512 complex-complex convolution */
+SIMD_TARGET("avx512f,avx2,fma")
+static int avx512_conv_cmplx(float *x, float *h, float *y, int h_len, int len)
+{
+	__mmask16 mask = (1 << (2 * (h_len % 8))) - 1;
+
+	for (int i = 0; i < len; i++)
+		avx_store_csum(&y[2 * i], avx512_dot_cmplx(&x[2 * i], h, h_len, mask));
+
+	return 0;
+}
+/*
+ * Polyphase filterbank kernels. Each partition is walked across all blocks
+ * before moving to the next so its taps stay resident, and the kernels are
+ * entered once per block rather than once per output sample.
+ */
+SIMD_TARGET("sse3")
+static int sse_conv_poly(const float *x, float **h, int h_len,
+			 const int *index, const int *path, int p, int q,
+			 float *y, int num_blks)
+{
+	if (h_len % 4)
+		return -1;
+
+	for (int n = 0; n < p; n++) {
+		for (int i = 0; i < num_blks; i++) {
+			sse_conv_real((float *) &x[2 * (i * q + index[n])],
+				      h[path[n]], &y[2 * (i * p + n)],
+				      h_len, 1);
+		}
+	}
+
+	return 0;
+}
+
+SIMD_TARGET("avx2,fma")
+static int avx2_conv_poly(const float *x, float **h, int h_len,
+			  const int *index, const int *path, int p, int q,
+			  float *y, int num_blks)
+{
+	__m256i mask = avx2_tail_mask(h_len);
+
+	for (int n = 0; n < p; n++) {
+		const float *_x = &x[2 * index[n]];
+		const float *_h = h[path[n]];
+
+		for (int i = 0; i < num_blks; i++) {
+			avx_store_csum(&y[2 * (i * p + n)],
+				       avx2_dot_real(&_x[2 * i * q], _h,
+						     h_len, mask));
+		}
+	}
+
+	return 0;
+}
+
+SIMD_TARGET("avx512f,avx2,fma")
+static int avx512_conv_poly(const float *x, float **h, int h_len,
+			    const int *index, const int *path, int p, int q,
+			    float *y, int num_blks)
+{
+	__mmask16 mask = (1 << (2 * (h_len % 8))) - 1;
+
+	for (int n = 0; n < p; n++) {
+		const float *_x = &x[2 * index[n]];
+		const float *_h = h[path[n]];
+
+		for (int i = 0; i < num_blks; i++) {
+			avx_store_csum(&y[2 * (i * p + n)],
+				       avx512_fold(avx512_dot_real(&_x[2 * i * q],
+								   _h, h_len,
+								   mask)));
+		}
+	}
+
+	return 0;
+}
+
+/*
+ * Fused demodulator kernels, the interpolator is evaluated only at the
+ * symbol instants and each symbol is sliced as soon as it is filtered
+ */
+SIMD_TARGET("avx2,fma")
+static int avx2_conv_soft(const float *x, int step, const float *h, int h_len,
+			  const float *r, const float *s, unsigned char *b,
+			  int len)
+{
+	__m256i mask = avx2_tail_mask(h_len);
+	float y[2];
+
+	for (int i = 0; i < len; i++) {
+		avx_store_csum(y, avx2_dot_real(&x[2 * i * step], h,
+						h_len, mask));
+		b[i] = soft_bit(y, &r[2 * i], s);
+	}
+
+	return 0;
+}
+
+SIMD_TARGET("avx512f,avx2,fma")
+static int avx512_conv_soft(const float *x, int step, const float *h,
+			    int h_len, const float *r, const float *s,
+			    unsigned char *b, int len)
+{
+	__mmask16 mask = (1 << (2 * (h_len % 8))) - 1;
+	float y[2];
+
+	for (int i = 0; i < len; i++) {
+		avx_store_csum(y, avx512_fold(avx512_dot_real(&x[2 * i * step],
+							      h, h_len,
+							      mask)));
+		b[i] = soft_bit(y, &r[2 * i], s);
+	}
+
+	return 0;
+}
+/* AVX2 clipping check over len interleaved values */
+SIMD_TARGET("avx2")
+static inline int avx2_clipped(const float *x, int len, float clip)
+{
+	__m256 m0, m1;
+	__m128 m2;
+	int i;
+
+	m0 = _mm256_setzero_ps();
+	m1 = _mm256_set1_ps(-0.0f);
+
+	for (i = 0; i + 8 <= len; i += 8)
+		m0 = _mm256_max_ps(m0, _mm256_andnot_ps(m1, _mm256_loadu_ps(&x[i])));
+
+	m2 = _mm_max_ps(_mm256_castps256_ps128(m0), _mm256_extractf128_ps(m0, 1));
+	m2 = _mm_max_ps(m2, _mm_movehl_ps(m2, m2));
+	m2 = _mm_max_ss(m2, _mm_shuffle_ps(m2, m2, _MM_SHUFFLE(1, 1, 1, 1)));
+
+	if (_mm_cvtss_f32(m2) > clip)
+		return 1;
+
+	for (; i < len; i++) {
+		if (fabsf(x[i]) > clip)
+			return 1;
+	}
+
+	return 0;
+}
+
+/*
+ * Fused detection kernels, the burst is scanned for clipping once and the
+ * correlation peak is tracked as each output is produced
+ */
+SIMD_TARGET("avx2,fma")
+static int avx2_conv_detect(const float *x, int x_len, float clip,
+			    const float *h, int h_len, float *y,
+			    int start, int len, float *peak)
+{
+	__m256i mask = avx2_tail_mask(h_len);
+	const float *_x = &x[2 * (start - (h_len - 1))];
+	int index = 0;
+
+	*peak = 0.0f;
+
+	if ((clip > 0.0f) && avx2_clipped(x, 2 * x_len, clip))
+		return -2;
+
+	for (int i = 0; i < len; i++) {
+		avx_store_csum(&y[2 * i], avx2_dot_cmplx(&_x[2 * i], h, h_len, mask));
+		track_peak(&y[2 * i], i, peak, &index);
+	}
+
+	return index;
+}
+
+SIMD_TARGET("avx512f,avx2,fma")
+static int avx512_conv_detect(const float *x, int x_len, float clip,
+			      const float *h, int h_len, float *y,
+			      int start, int len, float *peak)
+{
+	__mmask16 mask = (1 << (2 * (h_len % 8))) - 1;
+	const float *_x = &x[2 * (start - (h_len - 1))];
+	int index = 0;
+
+	*peak = 0.0f;
+
+	if ((clip > 0.0f) && avx2_clipped(x, 2 * x_len, clip))
+		return -2;
+
+	for (int i = 0; i < len; i++) {
+		avx_store_csum(&y[2 * i], avx512_dot_cmplx(&_x[2 * i], h, h_len, mask));
+		track_peak(&y[2 * i], i, peak, &index);
+	}
+
+	return index;
+}
+/*
+ * Batched AVX2/FMA detector. The taps of every set are split once into
+ * duplicated real parts and sign folded imaginary parts, so each set needs
+ * a single accumulator and no shuffles. Every input block is then loaded
+ * once and applied to all sets. Absent sets repeat the first one, giving
+ * the set loops a constant bound that keeps the accumulators in registers.
+ */
+SIMD_TARGET("avx2,fma")
+static int avx2_conv_detect_multi(const float *x, const float **h, int num,
+				  int h_len, float *y, int start, int len,
+				  int *index, float *peak)
+{
+	__m256 hr[CONV_MULTI_MAX][CONV_MULTI_TAPS / 4];
+	__m256 hi[CONV_MULTI_MAX][CONV_MULTI_TAPS / 4];
+	__m256 acc[CONV_MULTI_MAX], m0, m1, m2;
+	__m256i mask = avx2_tail_mask(h_len);
+	const float *_x = &x[2 * (start - (h_len - 1))];
+	int n, k, blks = (h_len + 3) / 4, tail = h_len / 4 * 4;
+
+	if (h_len > CONV_MULTI_TAPS)
+		return -1;
+
+	m1 = _mm256_setr_ps(-0.0f, 0.0f, -0.0f, 0.0f,
+			    -0.0f, 0.0f, -0.0f, 0.0f);
+
+	for (k = 0; k < CONV_MULTI_MAX; k++) {
+		const float *_h = h[(k < num) ? k : 0];
+
+		for (n = 0; n < blks; n++) {
+			if (4 * n < tail)
+				m0 = _mm256_loadu_ps(&_h[8 * n]);
+			else
+				m0 = _mm256_maskload_ps(&_h[8 * n], mask);
+
+			hr[k][n] = _mm256_moveldup_ps(m0);
+			hi[k][n] = _mm256_xor_ps(_mm256_movehdup_ps(m0), m1);
+		}
+	}
+
+	for (k = 0; k < num; k++) {
+		index[k] = 0;
+		peak[k] = 0.0f;
+	}
+
+	for (int i = 0; i < len; i++) {
+#pragma GCC unroll 8
+		for (k = 0; k < CONV_MULTI_MAX; k++)
+			acc[k] = _mm256_setzero_ps();
+
+		for (n = 0; n < blks; n++) {
+			if (4 * n < tail)
+				m0 = _mm256_loadu_ps(&_x[2 * (i + 4 * n)]);
+			else
+				m0 = _mm256_maskload_ps(&_x[2 * (i + 4 * n)], mask);
+			m2 = _mm256_permute_ps(m0, _MM_SHUFFLE(2, 3, 0, 1));
+
+#pragma GCC unroll 8
+			for (k = 0; k < CONV_MULTI_MAX; k++) {
+				acc[k] = _mm256_fmadd_ps(m0, hr[k][n], acc[k]);
+				acc[k] = _mm256_fmadd_ps(m2, hi[k][n], acc[k]);
+			}
+		}
+
+#pragma GCC unroll 8
+		for (k = 0; k < CONV_MULTI_MAX; k++) {
+			if (k >= num)
+				break;
+			avx_store_csum(&y[2 * (k * len + i)], acc[k]);
+			track_peak(&y[2 * (k * len + i)], i, &peak[k], &index[k]);
+		}
+	}
+
+	return 0;
+}
+#endif /* HAVE_SIMD_X86 */
 
 /* Base multiply and accumulate complex-real */
 static void mac_real(float *x, float *h, float *y)
@@ -557,6 +1147,94 @@ static int _base_convolve_complex(float *x, int x_len,
 	return len;
 }
 
+/* Base polyphase filterbank */
+static void _base_convolve_poly(const float *x, float **h, int h_len,
+				const int *index, const int *path, int p, int q,
+				float *y, int num_blks)
+{
+	for (int n = 0; n < p; n++) {
+		for (int i = 0; i < num_blks; i++) {
+			float *_y = &y[2 * (i * p + n)];
+
+			_y[0] = _y[1] = 0.0f;
+			mac_real_vec_n((float *) &x[2 * (i * q + index[n])],
+				       h[path[n]], _y, h_len, 1, 0);
+		}
+	}
+}
+
+/* Base fused demodulator */
+static void _base_convolve_soft(const float *x, int step,
+				const float *h, int h_len,
+				const float *r, const float *s,
+				unsigned char *b, int len)
+{
+	for (int i = 0; i < len; i++) {
+		float y[2] = { 0.0f, 0.0f };
+
+		if (h) {
+			mac_real_vec_n((float *) &x[2 * i * step], (float *) h,
+				       y, h_len, 1, 0);
+		} else {
+			y[0] = x[2 * i * step + 0];
+			y[1] = x[2 * i * step + 1];
+		}
+
+		b[i] = soft_bit(y, &r[2 * i], s);
+	}
+}
+
+/* Base fused detector, any tap step */
+static int _base_convolve_detect(const float *x, int x_len, float clip,
+				 const float *h, int h_len, float *y,
+				 int start, int len, int step, float *peak)
+{
+	int index = 0;
+
+	*peak = 0.0f;
+
+	if ((clip > 0.0f) && base_clipped(x, 2 * x_len, clip))
+		return -2;
+
+	for (int i = 0; i < len; i++) {
+		y[2 * i + 0] = y[2 * i + 1] = 0.0f;
+		mac_cmplx_vec_n((float *) &x[2 * (i - (h_len - 1) + start)],
+				(float *) h, &y[2 * i], h_len, step, 0);
+		track_peak(&y[2 * i], i, peak, &index);
+	}
+
+	return index;
+}
+
+/* Base batched detector, each input sample is read once for all sets */
+static void _base_convolve_detect_multi(const float *x, const float **h,
+					int num, int h_len, float *y,
+					int start, int len, int step,
+					int *index, float *peak)
+{
+	for (int k = 0; k < num; k++) {
+		index[k] = 0;
+		peak[k] = 0.0f;
+	}
+
+	for (int i = 0; i < len; i++) {
+		const float *_x = &x[2 * (i - (h_len - 1) + start)];
+		float acc[2 * CONV_MULTI_MAX] = { 0.0f };
+
+		for (int n = 0; n < h_len; n += step) {
+			for (int k = 0; k < num; k++)
+				mac_cmplx((float *) &_x[2 * n],
+					  (float *) &h[k][2 * n], &acc[2 * k]);
+		}
+
+		for (int k = 0; k < num; k++) {
+			y[2 * (k * len + i) + 0] = acc[2 * k + 0];
+			y[2 * (k * len + i) + 1] = acc[2 * k + 1];
+			track_peak(&y[2 * (k * len + i)], i, &peak[k], &index[k]);
+		}
+	}
+}
+
 /* Buffer validity checks */
 static int bounds_check(int x_len, int h_len, int y_len,
 			int start, int len, int step)
@@ -577,6 +1255,66 @@ static int bounds_check(int x_len, int h_len, int y_len,
 	return 0;
 }
 
+/*
+ * Convolution kernel registry, ordered from widest to narrowest instruction
+ * set. Kernels operate on unit step and zero offset only and return
+ * negative for unsupported tap counts, in which case the base
+ * implementation is used.
+ */
+struct conv_backend {
+	const char *name;
+	int flags;
+	int (*real)(float *x, float *h, float *y, int h_len, int len);
+	int (*cmplx)(float *x, float *h, float *y, int h_len, int len);
+	int (*poly)(const float *x, float **h, int h_len,
+		    const int *index, const int *path, int p, int q,
+		    float *y, int num_blks);
+	int (*soft)(const float *x, int step, const float *h, int h_len,
+		    const float *r, const float *s, unsigned char *b,
+		    int len);
+	int (*detect)(const float *x, int x_len, float clip,
+		      const float *h, int h_len, float *y,
+		      int start, int len, float *peak);
+	int (*detect_multi)(const float *x, const float **h, int num,
+			    int h_len, float *y, int start, int len,
+			    int *index, float *peak);
+};
+
+static const struct conv_backend conv_backends[] = {
+#ifdef HAVE_SIMD_X86
+	{ "AVX-512", SIMD_AVX512,
+	  avx512_conv_real, avx512_conv_cmplx, avx512_conv_poly,
+	  avx512_conv_soft, avx512_conv_detect, avx2_conv_detect_multi },
+	{ "AVX2/FMA", SIMD_AVX2,
+	  avx2_conv_real, avx2_conv_cmplx, avx2_conv_poly,
+	  avx2_conv_soft, avx2_conv_detect, avx2_conv_detect_multi },
+	{ "SSE3", SIMD_SSE3,
+	  sse_conv_real, sse_conv_cmplx, sse_conv_poly, NULL, NULL, NULL },
+#endif
+	{ "generic", 0, NULL, NULL, NULL, NULL, NULL, NULL },
+};
+
+#define NUM_CONV_BACKENDS \
+	(sizeof(conv_backends) / sizeof(conv_backends[0]))
+
+static const struct conv_backend *conv_backend =
+	&conv_backends[NUM_CONV_BACKENDS - 1];
+
+/* API: Select the widest kernel set supported by the running CPU */
+const char *convolve_init(void)
+{
+	int flags = simd_probe();
+
+	for (size_t i = 0; i < NUM_CONV_BACKENDS; i++) {
+		if ((conv_backends[i].flags & flags) == conv_backends[i].flags) {
+			conv_backend = &conv_backends[i];
+			break;
+		}
+	}
+
+	return conv_backend->name;
+}
+
 /* API: Aligned complex-real */
 int convolve_real(float *x, int x_len,
 		  float *h, int h_len,
@@ -584,52 +1322,20 @@ int convolve_real(float *x, int x_len,
 		  int start, int len,
 		  int step, int offset)
 {
-	void (*conv_func)(float *, float *, float *, int) = NULL;
-	void (*conv_func_n)(float *, float *, float *, int, int) = NULL;
-
 	if (bounds_check(x_len, h_len, y_len, start, len, step) < 0)
 		return -1;
 
-	memset(y, 0, len * 2 * sizeof(float));
+	if ((step == 1) && !offset && conv_backend->real &&
+	    !conv_backend->real(&x[2 * (-(h_len - 1) + start)],
+				h, y, h_len, len))
+		return len;
 
-#ifdef HAVE_SSE3
-	if (step <= 4) {
-		switch (h_len) {
-		case 4:
-			conv_func = sse_conv_real4;
-			break;
-		case 8:
-			conv_func = sse_conv_real8;
-			break;
-		case 12:
-			conv_func = sse_conv_real12;
-			break;
-		case 16:
-			conv_func = sse_conv_real16;
-			break;
-		case 20:
-			conv_func = sse_conv_real20;
-			break;
-		default:
-			if (!(h_len % 4))
-				conv_func_n = sse_conv_real4n;
-		}
-	}
-#endif
-	if (conv_func) {
-		conv_func(&x[2 * (-(h_len - 1) + start)],
-			  h, y, len);
-	} else if (conv_func_n) {
-		conv_func_n(&x[2 * (-(h_len - 1) + start)],
-			    h, y, h_len, len);
-	} else {
-		_base_convolve_real(x, x_len,
-				    h, h_len,
-				    y, y_len,
-				    start, len, step, offset);
-	}
+	memset(y, 0, len * 2 * sizeof(float));
 
-	return len;
+	return _base_convolve_real(x, x_len,
+				   h, h_len,
+				   y, y_len,
+				   start, len, step, offset);
 }
 
 /* API: Aligned complex-complex */
@@ -639,34 +1345,96 @@ int convolve_complex(float *x, int x_len,
 		     int start, int len,
 		     int step, int offset)
 {
-	void (*conv_func)(float *, float *, float *, int, int) = NULL;
-
 	if (bounds_check(x_len, h_len, y_len, start, len, step) < 0)
 		return -1;
 
+	if ((step == 1) && !offset && conv_backend->cmplx &&
+	    !conv_backend->cmplx(&x[2 * (-(h_len - 1) + start)],
+				 h, y, h_len, len))
+		return len;
+
 	memset(y, 0, len * 2 * sizeof(float));
 
-#ifdef HAVE_SSE3
-	if (step <= 4) {
-		if (!(h_len % 8))
-			conv_func = sse_conv_cmplx_8n;
-		else if (!(h_len % 4))
-			conv_func = sse_conv_cmplx_4n;
+	return _base_convolve_complex(x, x_len,
+				      h, h_len,
+				      y, y_len,
+				      start, len, step, offset);
+}
+
+/* API: Polyphase complex-real filterbank over blocks of p outputs */
+int convolve_polyphase(const float *x, float **h, int h_len,
+		       const int *index, const int *path, int p, int q,
+		       float *y, int num_blks)
+{
+	if ((h_len < 1) || (p < 1) || (q < 1) || (num_blks < 0)) {
+		fprintf(stderr, "Convolve: Invalid polyphase input\n");
+		return -1;
 	}
-#endif
-	if (conv_func) {
-		conv_func(&x[2 * (-(h_len - 1) + start)],
-			  h, y, h_len, len);
-	} else {
-		_base_convolve_complex(x, x_len,
-				       h, h_len,
-				       y, y_len,
-				       start, len, step, offset);
+
+	if (!conv_backend->poly ||
+	    conv_backend->poly(x, h, h_len, index, path, p, q, y, num_blks))
+		_base_convolve_poly(x, h, h_len, index, path, p, q, y, num_blks);
+
+	return num_blks * p;
+}
+
+/* API: Fused filter, derotation and soft bit slicing at symbol spacing */
+int convolve_soft_bits(const float *x, int step, const float *h, int h_len,
+		       const float *r, const float *s, unsigned char *b,
+		       int len)
+{
+	if ((h && (h_len < 1)) || (step < 1) || (len < 0)) {
+		fprintf(stderr, "Convolve: Invalid soft bit input\n");
+		return -1;
 	}
 
+	if (!h || !conv_backend->soft ||
+	    conv_backend->soft(x, step, h, h_len, r, s, b, len))
+		_base_convolve_soft(x, step, h, h_len, r, s, b, len);
+
 	return len;
 }
 
+/* API: Fused clipping check, correlation and peak search */
+int convolve_detect(const float *x, int x_len, float clip,
+		    const float *h, int h_len, float *y,
+		    int start, int len, int step, float *peak)
+{
+	if (bounds_check(x_len, h_len, len, start, len, step) < 0)
+		return -1;
+
+	if ((step == 1) && conv_backend->detect)
+		return conv_backend->detect(x, x_len, clip, h, h_len, y,
+					    start, len, peak);
+
+	return _base_convolve_detect(x, x_len, clip, h, h_len, y,
+				     start, len, step, peak);
+}
+
+/* API: Batched correlation and peak search over several tap sets */
+int convolve_detect_multi(const float *x, int x_len,
+			  const float **h, int num, int h_len, float *y,
+			  int start, int len, int step, int *index, float *peak)
+{
+	if (bounds_check(x_len, h_len, len, start, len, step) < 0)
+		return -1;
+
+	if ((num < 1) || (num > CONV_MULTI_MAX)) {
+		fprintf(stderr, "Convolve: Invalid tap set count %i\n", num);
+		return -1;
+	}
+
+	if ((step == 1) && conv_backend->detect_multi &&
+	    !conv_backend->detect_multi(x, h, num, h_len, y, start, len,
+					index, peak))
+		return 0;
+
+	_base_convolve_detect_multi(x, h, num, h_len, y, start, len, step,
+				    index, peak);
+
+	return 0;
+}
+
 /* API: Non-aligned (no SSE) complex-real */
 int base_convolve_real(float *x, int x_len,
 		       float *h, int h_len,
@@ -706,9 +1474,5 @@ int base_convolve_complex(float *x, int x_len,
 /* Aligned filter tap allocation */
 void *convolve_h_alloc(int len)
 {
-#ifdef HAVE_SSE3
-	return memalign(16, len * 2 * sizeof(float));
-#else
-	return malloc(len * 2 * sizeof(float));
-#endif
+	return memalign(CONV_ALIGN, len * 2 * sizeof(float));
 }
@@ -3,6 +3,9 @@
 
 void *convolve_h_alloc(int num);
 
+/* Probe the CPU and select convolution kernels, returns the kernel set name */
+const char *convolve_init(void);
+
 int convolve_real(float *x, int x_len,
 		  float *h, int h_len,
 		  float *y, int y_len,
@@ -15,6 +18,46 @@ int convolve_complex(float *x, int x_len,
 		     int start, int len,
 		     int step, int offset);
 
+/*
+ * Polyphase filterbank with real taps stored as in convolve_real(). Output
+ * n of block i is the dot product of the h_len inputs starting at
+ * x[i * q + index[n]] with partition h[path[n]], for n < p.
+ */
+int convolve_polyphase(const float *x, float **h, int h_len,
+		       const int *index, const int *path, int p, int q,
+		       float *y, int num_blks);
+
+/*
+ * Fused burst demodulator. Symbol i is the complex-real dot product of the
+ * h_len inputs starting at x[i * step] with h, or x[i * step] itself when h
+ * is NULL, rotated by r[i] and scaled by s. Its real part is sliced from
+ * [-1, 1] onto the soft bit b[i] in [0, 255].
+ */
+int convolve_soft_bits(const float *x, int step, const float *h, int h_len,
+		       const float *r, const float *s, unsigned char *b,
+		       int len);
+
+/*
+ * Fused burst detector. The x_len burst samples are checked for any
+ * component beyond clip, unless clip is zero, then len correlation outputs
+ * are written to y as convolve_complex() with zero offset. Returns the
+ * index of the output of largest power, first on ties, with that power in
+ * peak. Returns -1 on invalid input and -2 when the burst is clipped.
+ */
+int convolve_detect(const float *x, int x_len, float clip,
+		    const float *h, int h_len, float *y,
+		    int start, int len, int step, float *peak);
+
+/*
+ * Batched form of convolve_detect() without the clipping check. The num
+ * tap sets, at most 8, share h_len and each input load. Outputs of set k
+ * are written to y[k * len] onwards and its peak to index[k] and peak[k].
+ * Returns zero, or -1 on invalid input.
+ */
+int convolve_detect_multi(const float *x, int x_len,
+			  const float **h, int num, int h_len, float *y,
+			  int start, int len, int step, int *index, float *peak);
+
 int base_convolve_real(float *x, int x_len,
 		       float *h, int h_len,
 		       float *y, int y_len,
@@ -0,0 +1,67 @@
+#include "mirrorRing.h"
+
+#include <sys/mman.h>
+#include <unistd.h>
+
+#define SPDLOG_ACTIVE_LEVEL SPDLOG_LEVEL_DEBUG
+#include "spdlog/spdlog.h"
+
+MirrorRing::~MirrorRing() {
+    close();
+}
+
+/*
+ * Reserve twice the ring size of address space, then map the same memfd
+ * pages over both halves. The memfd is closed once mapped, the mappings keep
+ * the memory alive until close().
+ */
+bool MirrorRing::init(size_t minBytes) {
+    size_t page = sysconf(_SC_PAGESIZE);
+    size_t len = (minBytes + page - 1) / page * page;
+
+    close();
+
+    int fd = memfd_create("mirror-ring", MFD_CLOEXEC);
+    if (fd < 0) {
+        SPDLOG_ERROR("Mirrored ring memfd_create failed");
+        return false;
+    }
+
+    if (ftruncate(fd, len) < 0) {
+        SPDLOG_ERROR("Mirrored ring ftruncate failed");
+        ::close(fd);
+        return false;
+    }
+
+    void * addr = mmap(nullptr, 2 * len, PROT_NONE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (addr == MAP_FAILED) {
+        SPDLOG_ERROR("Mirrored ring address reservation failed");
+        ::close(fd);
+        return false;
+    }
+
+    char * base = (char *) addr;
+    if ((mmap(base, len, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_FIXED, fd, 0) == MAP_FAILED) ||
+        (mmap(base + len, len, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_FIXED, fd, 0) == MAP_FAILED)) {
+        SPDLOG_ERROR("Mirrored ring mapping failed");
+        munmap(addr, 2 * len);
+        ::close(fd);
+        return false;
+    }
+
+    ::close(fd);
+
+    m_data = base;
+    m_size = len;
+
+    return true;
+}
+
+void MirrorRing::close() {
+    if (m_data) {
+        munmap(m_data, 2 * m_size);
+    }
+
+    m_data = nullptr;
+    m_size = 0;
+}
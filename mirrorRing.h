@@ -0,0 +1,38 @@
+#ifndef OBTS_TRANSCEIVER52M_MIRRORRING_H
+#define OBTS_TRANSCEIVER52M_MIRRORRING_H
+
+#include <cstddef>
+
+/**
+    Ring buffer memory mapped twice back to back. Byte i and byte i + size()
+    are the same memory, so any span of up to size() bytes starting inside the
+    ring is contiguous, and cursors advance modulo size() without copying.
+*/
+class MirrorRing {
+public:
+    MirrorRing() = default;
+
+    ~MirrorRing();
+
+    MirrorRing(const MirrorRing &) = delete;
+
+    MirrorRing &operator=(const MirrorRing &) = delete;
+
+    /** map a ring of at least minBytes, rounded up to whole pages, returns false on failure */
+    bool init(size_t minBytes);
+
+    /** unmap the ring */
+    void close();
+
+    /** start of the ring, valid for 2 * size() bytes */
+    void * data() { return m_data; }
+
+    /** ring size in bytes */
+    size_t size() const { return m_size; }
+
+private:
+    char * m_data = nullptr;
+    size_t m_size = 0;
+};
+
+#endif //OBTS_TRANSCEIVER52M_MIRRORRING_H
@@ -6,6 +6,16 @@
 
 #define GSMRATE 1625e3/6
 
+/*
+ * Receive half-band stages run on the host for each resampling interface
+ * type. The device streams receive samples at 2^N times the rational
+ * resampler input rate and every stage decimates by two. Neither device
+ * type uses a stage: the rational resampler costs the same per output
+ * sample whatever its input rate, so a stage in front of it only adds work.
+ */
+#define RESAMP_64M_RX_HALFBANDS     0
+#define RESAMP_100M_RX_HALFBANDS    0
+
 /** a 64-bit virtual timestamp for radio data */
 typedef uint64_t TIMESTAMP;
 
@@ -127,6 +137,12 @@ public:
     // FIXME: Should these be uint64_t?  Double seems wrong for counting samples.
     virtual double numberRead() = 0;
     virtual double numberWritten() = 0;
+
+    /** Number of samples written but not yet sent to the radio */
+    virtual size_t txQueueDepth() = 0;
+
+    /** Number of samples that can wait to be sent to the radio, 0 if writes are sent directly */
+    virtual size_t txQueueCapacity() = 0;
 };
 
 #endif //OBTS_TRANSCEIVER52M_RADIODEVICE_H
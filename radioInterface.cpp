@@ -22,7 +22,6 @@ RadioInterface::~RadioInterface() {
     delete m_send_buffer;
     delete m_recv_buffer;
     delete m_convert_send_buffer;
-    delete m_convert_recv_buffer;
 
     m_send_buffer = nullptr;
     m_recv_buffer = nullptr;
@@ -39,14 +38,28 @@ bool RadioInterface::init(int type) {
 
     close();
 
+    SPDLOG_INFO("Using {} sample conversion kernels", convert_init());
+
     // FIXME: Put these defines somewhere sane, like a static variable in the class?
     m_send_buffer = new signalVector(CHUNK * m_sps_tx);
-    m_recv_buffer = new signalVector(NUMCHUNKS * CHUNK * m_sps_rx);
 
+    /*
+     * Received samples stay in device format until a burst is sliced out.
+     * The receive buffer is a mirrored ring, so slots that wrap around the
+     * end are still contiguous and consumed samples are never moved.
+     */
+    if (!m_recv_ring.init(NUMCHUNKS * CHUNK * m_sps_rx * 2 * sizeof(short))) {
+        SPDLOG_ERROR("Failed to map the receive buffer");
+        return false;
+    }
+    m_recv_size = m_recv_ring.size() / (2 * sizeof(short));
     m_convert_send_buffer = new short[m_send_buffer->size() * 2];
-    m_convert_recv_buffer = new short[m_recv_buffer->size() * 2];
+    m_convert_recv_buffer = (short *) m_recv_ring.data();
 
+    m_send_start = 0;
     m_send_cursor = 0;
+    m_send_converted = 0;
+    m_recv_start = 0;
     m_recv_cursor = 0;
 
     return true;
@@ -56,12 +69,14 @@ void RadioInterface::close() {
     delete m_send_buffer;
     delete m_recv_buffer;
     delete m_convert_send_buffer;
-    delete m_convert_recv_buffer;
 
     m_send_buffer = nullptr;
     m_recv_buffer = nullptr;
     m_convert_send_buffer = nullptr;
     m_convert_recv_buffer = nullptr;
+
+    m_send_ring.close();
+    m_recv_ring.close();
 }
 
 
@@ -84,13 +99,15 @@ void RadioInterface::setPowerAttenuation(double atten) {
         m_power_scaling = 1.0;
     else
         m_power_scaling = 1.0 / sqrt(pow(10, (digAtten / 10.0)));
+
+    m_power_epoch++;
 }
 
 // FIXME: This appears to be just copying data from one data structure to another.  This
 //        shouldn't use memset or memcpy, but instead should use a more modern method.
 //        Really should let the compiler handle this.  Also, see if it's possible to not
 //        need to do this copy in the first place.
-int RadioInterface::radioifyVector(signalVector &wVector, float * retVector, bool zero) {
+int RadioInterface::radioifyVector(const signalVector &wVector, float * retVector, bool zero) {
     if (zero) {
         memset(retVector, 0, wVector.size() * 2 * sizeof(float));
         return wVector.size();
@@ -101,23 +118,16 @@ int RadioInterface::radioifyVector(signalVector &wVector, float * retVector, boo
     return wVector.size();
 }
 
-// FIXME: This appears to be just copying data from one data structure to another.  This
-//        shouldn't use memset or memcopy, but instead should use a more modern method.
-//        Really should let the compiler handle this.  Also, see if it's possible to not
-//        need to do this copy in the first place.
-int RadioInterface::unRadioifyVector(float * floatVector, signalVector &newVector) {
-    signalVector::iterator itr = newVector.begin();
-
-    if (newVector.size() > m_recv_cursor) {
-        SPDLOG_ERROR("Insufficient number of samples in receive buffer");
-        return -1;
-    }
-
-    for (int i = 0; i < newVector.size(); i++) {
-        *itr++ = std::complex<float>(floatVector[2 * i + 0], floatVector[2 * i + 1]);
-    }
+/*
+ * Bursts are converted to float only when sliced, so timeslots the receive
+ * schedule skips are never converted at all.
+ */
+void RadioInterface::sliceRecvBuffer(unsigned offset, signalVector &burst) {
+    convertRecvSamples((float *) burst.begin(), m_convert_recv_buffer + 2 * (m_recv_start + offset), burst.size());
+}
 
-    return newVector.size();
+void RadioInterface::consumeRecvBuffer(unsigned len) {
+    m_recv_start = (m_recv_start + len) % m_recv_size;
 }
 
 bool RadioInterface::tuneTx(double freq) {
@@ -162,16 +172,99 @@ void RadioInterface::alignRadio() {
 }
 #endif
 
-void RadioInterface::driveTransmitRadio(signalVector &radioBurst, bool zeroBurst) {
+void RadioInterface::driveTransmitRadio(const signalVector &radioBurst, bool zeroBurst) {
     if (!m_radio_on) {
         return;
     }
 
-    radioifyVector(radioBurst, (float *) (m_send_buffer->begin() + m_send_cursor), zeroBurst);
+    radioifyVector(radioBurst, (float *) (m_send_buffer->begin() + m_send_start + m_send_cursor), zeroBurst);
     m_send_cursor += radioBurst.size();
     pushBuffer();
 }
 
+/*
+ * Bursts are summed straight into the send buffer through the write cursor,
+ * so transmit assembly needs no intermediate vectors.
+ */
+std::complex<float> * RadioInterface::getWriteCursor(size_t len) {
+    if (!m_radio_on) {
+        return nullptr;
+    }
+
+    if (m_send_cursor + len > m_send_buffer->size()) {
+        SPDLOG_ERROR("Send buffer overflow");
+        return nullptr;
+    }
+
+    std::complex<float> * cursor = m_send_buffer->begin() + m_send_start + m_send_cursor;
+    std::fill_n(cursor, len, std::complex<float>(0.0f));
+
+    return cursor;
+}
+
+void RadioInterface::commitWriteCursor(size_t len) {
+    m_send_cursor += len;
+    pushBuffer();
+}
+
+void RadioInterface::convertBurst(const signalVector &burst, short * out) {
+    convert_float_short(out, (float *) burst.begin(), m_power_scaling, 2 * burst.size());
+}
+
+/*
+ * Converted bursts are copied straight into the device format buffer. Float
+ * samples queued ahead of them are converted first, so the send buffer always
+ * holds a converted prefix followed by float samples still to be converted.
+ */
+void RadioInterface::driveTransmitConverted(const short * samples, size_t len) {
+    if (!m_radio_on || !canPreconvert()) {
+        return;
+    }
+
+    if (m_send_cursor + len > m_send_buffer->size()) {
+        SPDLOG_ERROR("Send buffer overflow");
+        return;
+    }
+
+    convertSendSamples();
+    memcpy(m_convert_send_buffer + 2 * m_send_cursor, samples, len * 2 * sizeof(short));
+    m_send_cursor += len;
+    m_send_converted = m_send_cursor;
+    pushBuffer();
+}
+
+/*
+ * Device format bursts are summed straight into the device sample buffer,
+ * the float send buffer and the conversion pass are skipped entirely.
+ */
+short * RadioInterface::getDeviceWriteCursor(size_t len) {
+    if (!m_radio_on || !canPreconvert()) {
+        return nullptr;
+    }
+
+    if (m_send_cursor + len > m_send_buffer->size()) {
+        SPDLOG_ERROR("Send buffer overflow");
+        return nullptr;
+    }
+
+    convertSendSamples();
+
+    short * cursor = m_convert_send_buffer + 2 * m_send_cursor;
+    std::fill_n(cursor, 2 * len, 0);
+
+    return cursor;
+}
+
+void RadioInterface::addDeviceBurst(short * cursor, const short * burst, size_t len) {
+    convert_short_add(cursor, burst, m_power_scaling, 2 * len);
+}
+
+void RadioInterface::commitDeviceWriteCursor(size_t len) {
+    m_send_cursor += len;
+    m_send_converted = m_send_cursor;
+    pushBuffer();
+}
+
 // FIXME: From GSMTransfer.h
 static const unsigned gSlotLen = 148;	///< number of symbols per slot, not counting guard periods
 
@@ -205,24 +298,27 @@ void RadioInterface::driveReceiveRadio() {
     //    GSM bursts and pass up to Transceiver
     // Using the 157-156-156-156 symbols per timeslot format.
     while (rcvSz > (symbolsPerSlot + (tN % 4 == 0)) * m_sps_rx) {
-        signalVector rxVector((symbolsPerSlot + (tN % 4 == 0)) * m_sps_rx);
-        SPDLOG_DEBUG("After signalVector");
-        unRadioifyVector((float *) (m_recv_buffer->begin() + readSz), rxVector);
-        SPDLOG_DEBUG("After unRadioifyVector");
         GsmTime tmpTime = rcvClock;
         if (rcvClock.FN() >= 0) {
             //LOG(DEBUG) << "FN: " << rcvClock.FN();
             radioVector * rxBurst = nullptr;
-            if (!m_load_test)
-                rxBurst = new radioVector(rxVector, tmpTime);
-            else {
+            if (m_recv_filter && !m_recv_filter(tmpTime)) {
+                // Not scheduled for reception, the samples are never converted
+            } else if (!m_load_test) {
+                // Unpack straight into the burst, with guards so the demodulator filters it in place
+                rxBurst = radioVector::make((symbolsPerSlot + (tN % 4 == 0)) * m_sps_rx,
+                                            SIGNAL_GUARD_LEN, SIGNAL_GUARD_LEN, tmpTime);
+                sliceRecvBuffer(readSz, *rxBurst);
+                SPDLOG_DEBUG("After sliceRecvBuffer");
+            } else {
                 // FIXME: Should there be load test code here?
                 if (tN % 4 == 0)
                     rxBurst = new radioVector(*m_final_vec9, tmpTime);
                 else
                     rxBurst = new radioVector(*m_final_vec, tmpTime);
             }
-            m_receive_fifo.put(rxBurst);
+            if (rxBurst)
+                m_receive_fifo.put(rxBurst);
         }
         SPDLOG_DEBUG("After rxBurst");
         m_clock.incTN();
@@ -237,8 +333,7 @@ void RadioInterface::driveReceiveRadio() {
     SPDLOG_DEBUG("After while loop");
 
     if (readSz > 0) {
-        // FIXME: Again, need to do this in a more modern way, one that's safer and the compiler will optimize.
-        memmove(m_recv_buffer->begin(), m_recv_buffer->begin() + readSz, (m_recv_cursor - readSz) * 2 * sizeof(float));
+        consumeRecvBuffer(readSz);
 
         m_recv_cursor -= readSz;
     }
@@ -267,31 +362,49 @@ double RadioInterface::getRxGain() {
     return -1;
 }
 
-/* Receive a timestamped chunk from the device */
+void RadioInterface::setDCRemoval(bool enable) {
+    m_dc_removal = enable;
+    m_rx_dc[0] = 0.0f;
+    m_rx_dc[1] = 0.0f;
+}
+
+/*
+ * Convert interleaved device samples to float. With DC removal enabled the
+ * current offset estimate is subtracted in the same pass and the estimate is
+ * updated from the block mean with a single pole average.
+ */
+void RadioInterface::convertRecvSamples(float * out, short * in, int num) {
+    const float alpha = 0.01f;
+    float mean[2];
+
+    if (!m_dc_removal) {
+        convert_short_float(out, in, 2 * num);
+        return;
+    }
+
+    convert_short_float_dc(out, in, m_rx_dc, mean, 2 * num);
+
+    m_rx_dc[0] += alpha * (mean[0] - m_rx_dc[0]);
+    m_rx_dc[1] += alpha * (mean[1] - m_rx_dc[1]);
+}
+
+/* Receive a timestamped chunk from the device, straight to the end of the receive buffer */
 void RadioInterface::pullBuffer() {
     bool local_underrun;
     int num_recv;
-    float * output;
 
-    if (m_recv_cursor > m_recv_buffer->size() - CHUNK) {
+    if (m_recv_cursor > m_recv_size - CHUNK) {
         return;
     }
 
     /* Outer buffer access size is fixed */
     SPDLOG_DEBUG("Just before readSamples");
-    num_recv = m_radio->readSamples(m_convert_recv_buffer, CHUNK, &m_overrun, m_read_timestamp, &local_underrun);
+    num_recv = m_radio->readSamples(m_convert_recv_buffer + 2 * (m_recv_start + m_recv_cursor), CHUNK, &m_overrun, m_read_timestamp, &local_underrun);
     if (num_recv != CHUNK) {
         SPDLOG_ERROR("Receive error {}", num_recv);
         return;
     }
 
-    SPDLOG_DEBUG("Just before output");
-    output = (float *) (m_recv_buffer->begin() + m_recv_cursor);
-    SPDLOG_DEBUG("About to convert_short_float, output: {}", *output);
-    convert_short_float(output, m_convert_recv_buffer, 2 * num_recv);
-    SPDLOG_DEBUG("After convert_short_float");
-
-
     m_underrun |= local_underrun;
 
     m_read_timestamp += num_recv;
@@ -299,6 +412,17 @@ void RadioInterface::pullBuffer() {
     SPDLOG_DEBUG("End PullBuffer, m_underrun: {}, m_read_timestamp: {}, m_recv_cursor:{}", m_underrun, m_read_timestamp, m_recv_cursor);
 }
 
+void RadioInterface::convertSendSamples() {
+    if (m_send_cursor <= m_send_converted) {
+        return;
+    }
+
+    convert_float_short(m_convert_send_buffer + 2 * m_send_converted,
+                        (float *) (m_send_buffer->begin() + m_send_converted),
+                        m_power_scaling, 2 * (m_send_cursor - m_send_converted));
+    m_send_converted = m_send_cursor;
+}
+
 /* Send timestamped chunk to the device with arbitrary size */
 void RadioInterface::pushBuffer() {
     int num_sent;
@@ -311,7 +435,7 @@ void RadioInterface::pushBuffer() {
         SPDLOG_ERROR("Send buffer overflow");
     }
 
-    convert_float_short(m_convert_send_buffer, (float *) m_send_buffer->begin(), m_power_scaling, 2 * m_send_cursor);
+    convertSendSamples();
 
     /* Send the all samples in the send buffer */
     num_sent = m_radio->writeSamples(m_convert_send_buffer, m_send_cursor, &m_underrun, m_write_timestamp);
@@ -321,4 +445,5 @@ void RadioInterface::pushBuffer() {
 
     m_write_timestamp += num_sent;
     m_send_cursor = 0;
+    m_send_converted = 0;
 }
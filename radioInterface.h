@@ -1,8 +1,12 @@
 #ifndef OBTS_TRANSCEIVER52M_RADIOINTERFACE_H
 #define OBTS_TRANSCEIVER52M_RADIOINTERFACE_H
 
+#include <atomic>
+#include <functional>
+
 #include "gsmtime.h"
 #include "LinkedLists.h"
+#include "mirrorRing.h"
 #include "radioDevice.h"
 #include "radioVector.h"
 #include "radioClock.h"
@@ -51,13 +55,47 @@ public:
     double getRxGain(void);
 
     /** drive transmission of GSM bursts */
-    void driveTransmitRadio(signalVector &radioBurst, bool zeroBurst);
+    void driveTransmitRadio(const signalVector &radioBurst, bool zeroBurst);
+
+    /** zero len samples at the transmit write cursor and return them, NULL if the radio is off or the buffer is full */
+    std::complex<float> * getWriteCursor(size_t len);
+
+    /** advance the transmit write cursor past len samples and push them to the device */
+    void commitWriteCursor(size_t len);
+
+    /** whether bursts can be converted to device samples ahead of transmission, false when resampling */
+    virtual bool canPreconvert() { return true; }
+
+    /** convert a burst to interleaved device samples at the current transmit power scaling */
+    void convertBurst(const signalVector &burst, short * out);
+
+    /** drive transmission of a burst already converted with convertBurst() */
+    void driveTransmitConverted(const short * samples, size_t len);
+
+    /** zero len device samples at the transmit write cursor and return them, NULL if the radio is off,
+        the buffer is full or bursts cannot be preconverted */
+    short * getDeviceWriteCursor(size_t len);
+
+    /** saturating add of a device format burst at the current transmit power scaling */
+    void addDeviceBurst(short * cursor, const short * burst, size_t len);
+
+    /** advance the transmit write cursor past len device samples and push them to the device */
+    void commitDeviceWriteCursor(size_t len);
 
     /** drive reception of GSM bursts */
     void driveReceiveRadio();
 
+    /** set the receive schedule, bursts are only sliced from the receive buffer for times it accepts */
+    void setReceiveFilter(std::function<bool(const GsmTime &)> filter) { m_recv_filter = std::move(filter); }
+
     void setPowerAttenuation(double atten);
 
+    /** returns a count that changes whenever the transmit power scaling changes */
+    unsigned powerEpoch() { return m_power_epoch; }
+
+    /** enable or disable receive DC offset removal during sample conversion */
+    void setDCRemoval(bool enable);
+
     /** returns the full-scale transmit amplitude **/
     double fullScaleInputValue();
 
@@ -70,6 +108,12 @@ public:
     /** get transport window type of attached device */
     enum RadioDevice::TxWindowType getWindowType() { return m_radio->getWindowType(); }
 
+    /** number of transmit samples queued in the attached device */
+    size_t txQueueDepth() { return m_radio->txQueueDepth(); }
+
+    /** transmit queue capacity of the attached device in whole TDMA frames */
+    unsigned txQueueFrames() { return m_radio->txQueueCapacity() / m_radio->getSampleRate() * GSMRATE / 1250; }
+
 protected:
     Thread m_thread; // thread that synchronizes transmit and receive sections
     VectorFIFO m_receive_fifo; // FIFO that holds receive  bursts
@@ -78,12 +122,19 @@ protected:
     int m_sps_tx = 1;
     int m_sps_rx = 1;
     signalVector * m_send_buffer = nullptr;
-    signalVector * m_recv_buffer = nullptr;
+    signalVector * m_recv_buffer = nullptr; // float receive buffer, only used when resampling
+    unsigned m_recv_size = 0; // receive buffer capacity in samples
+    unsigned m_send_start = 0; // ring position of the oldest unsent sample, 0 unless resampling
     unsigned m_send_cursor = 0;
+    unsigned m_send_converted = 0; // leading send buffer samples already in device format
+    unsigned m_recv_start = 0; // ring position of the oldest unread receive sample
     unsigned m_recv_cursor = 0;
 
+    MirrorRing m_send_ring; // mirrored send buffer memory, only used when resampling
+    MirrorRing m_recv_ring; // mirrored receive buffer memory
+
     short * m_convert_send_buffer = nullptr;
-    short * m_convert_recv_buffer = nullptr;
+    short * m_convert_recv_buffer = nullptr; // device format receive buffer, sliced without resampling
 
     bool m_underrun = false; // indicates writes to USRP are too slow
     bool m_overrun = false; // indicates reads from USRP are too slow
@@ -95,6 +146,15 @@ protected:
     int m_receive_offset; // offset b/w transmit and receive GSM timestamps, in timeslots
     bool m_radio_on = false; // indicates radio is on
     double m_power_scaling = 1.0;
+    std::atomic<unsigned> m_power_epoch{0}; // bumped on every transmit power scaling change
+
+    std::function<bool(const GsmTime &)> m_recv_filter; // receive schedule, NULL accepts every burst
+
+    bool m_dc_removal = false; // remove the receive DC offset on conversion
+    float m_rx_dc[2] = {0.0f, 0.0f}; // running I/Q receive DC offset estimate
+
+    /** convert received device samples, removing DC offset if enabled */
+    void convertRecvSamples(float * out, short * in, int num);
 
     bool m_load_test = false;
     int m_num_arfcns = 0;
@@ -104,12 +164,18 @@ protected:
 private:
 
     /** format samples to USRP */
-    int radioifyVector(signalVector &wVector,
+    int radioifyVector(const signalVector &wVector,
                        float * floatVector,
                        bool zero);
 
-    /** format samples from USRP */
-    int unRadioifyVector(float * floatVector, signalVector &wVector);
+    /** format len samples at offset in the receive buffer into a burst */
+    virtual void sliceRecvBuffer(unsigned offset, signalVector &burst);
+
+    /** drop len sliced samples from the front of the receive buffer */
+    virtual void consumeRecvBuffer(unsigned len);
+
+    /** convert pending send buffer samples to device format */
+    void convertSendSamples();
 
     /** push GSM bursts into the transmit buffer */
     virtual void pushBuffer(void);
@@ -142,7 +208,14 @@ public:
 
     void close();
 
+    /** device samples depend on neighbouring bursts through the upsampler */
+    bool canPreconvert() override { return false; }
+
 private:
+    void sliceRecvBuffer(unsigned offset, signalVector &burst) override;
+
+    void consumeRecvBuffer(unsigned len) override;
+
     signalVector * m_inner_send_buffer = nullptr;
     signalVector * m_outer_send_buffer = nullptr;
     signalVector * m_inner_recv_buffer = nullptr;
@@ -1,3 +1,5 @@
+#include <vector>
+
 #include "radioInterface.h"
 
 #define SPDLOG_ACTIVE_LEVEL SPDLOG_LEVEL_DEBUG
@@ -5,6 +7,7 @@
 
 
 #include "Resampler.h"
+#include "Halfband.h"
 
 extern "C" {
 #include "convert.h"
@@ -18,6 +21,13 @@ extern "C" {
 #define RESAMP_100M_INRATE            52
 #define RESAMP_100M_OUTRATE            75
 
+/*
+ * Receive half-band decimation stages ahead of the rational resampler, the
+ * stage counts per device type are in radioDevice.h since the device opens
+ * its receive stream at the matching rate.
+ */
+#define RESAMP_RX_HALFBAND_TAPS       23
+
 /* Universal resampling parameters */
 #define NUMCHUNKS                24
 
@@ -33,10 +43,13 @@ extern "C" {
 // FIXME: Make these globals go away at some point in the future.
 static Resampler * upsampler = nullptr;
 static Resampler * dnsampler = nullptr;
+static std::vector<HalfbandDecimator<RESAMP_RX_HALFBAND_TAPS> *> rx_halfbands;
 static int resamp_inrate = 0;
 static int resamp_inchunk = 0;
 static int resamp_outrate = 0;
 static int resamp_outchunk = 0;
+static int resamp_rx_outchunk = 0;
+static int resamp_rx_delay = 0;
 
 short * convertRecvBuffer = nullptr;
 short * convertSendBuffer = nullptr;
@@ -53,6 +66,11 @@ RadioInterfaceResamp::~RadioInterfaceResamp() {
     delete upsampler;
     delete dnsampler;
 
+    for (auto hb : rx_halfbands) {
+        delete hb;
+    }
+    rx_halfbands.clear();
+
     m_inner_send_buffer = nullptr;
     m_outer_send_buffer = nullptr;
     m_inner_recv_buffer = nullptr;
@@ -73,6 +91,11 @@ void RadioInterfaceResamp::close() {
     delete upsampler;
     delete dnsampler;
 
+    for (auto hb : rx_halfbands) {
+        delete hb;
+    }
+    rx_halfbands.clear();
+
     m_inner_send_buffer = nullptr;
     m_outer_send_buffer = nullptr;
     m_inner_recv_buffer = nullptr;
@@ -83,23 +106,31 @@ void RadioInterfaceResamp::close() {
     upsampler = nullptr;
     dnsampler = nullptr;
 
+    m_send_ring.close();
+    m_recv_ring.close();
+
     RadioInterface::close();
 }
 
 /* Initialize I/O specific objects */
 bool RadioInterfaceResamp::init(int type) {
     float cutoff = 1.0f;
+    int num_halfbands = 0;
 
     close();
 
+    SPDLOG_INFO("Using {} sample conversion kernels", convert_init());
+
     switch (type) {
         case RadioDevice::RESAMP_64M:
             resamp_inrate = RESAMP_64M_INRATE;
             resamp_outrate = RESAMP_64M_OUTRATE;
+            num_halfbands = RESAMP_64M_RX_HALFBANDS;
             break;
         case RadioDevice::RESAMP_100M:
             resamp_inrate = RESAMP_100M_INRATE;
             resamp_outrate = RESAMP_100M_OUTRATE;
+            num_halfbands = RESAMP_100M_RX_HALFBANDS;
             break;
         case RadioDevice::NORMAL:
         default:
@@ -109,6 +140,10 @@ bool RadioInterfaceResamp::init(int type) {
 
     resamp_inchunk = resamp_inrate * 4;
     resamp_outchunk = resamp_outrate * 4;
+    resamp_rx_outchunk = resamp_outchunk << num_halfbands;
+
+    /* Each stage delays by half its length at its own input rate, read that much later */
+    resamp_rx_delay = (RESAMP_RX_HALFBAND_TAPS - 1) / 2 * ((1 << num_halfbands) - 1);
 
     if (resamp_inchunk * NUMCHUNKS < 157 * m_sps_tx * 2) {
         SPDLOG_ERROR("Invalid inner chunk size {}", resamp_inchunk);
@@ -125,6 +160,15 @@ bool RadioInterfaceResamp::init(int type) {
         return false;
     }
 
+    /* Half-band stages run from the device rate down to the rational stage */
+    for (int i = 0; i < num_halfbands; i++) {
+        rx_halfbands.push_back(new HalfbandDecimator<RESAMP_RX_HALFBAND_TAPS>(resamp_rx_outchunk >> i));
+    }
+
+    if (num_halfbands) {
+        SPDLOG_INFO("Receive chain with {} half-band stages", num_halfbands);
+    }
+
     upsampler = new Resampler(resamp_outrate, resamp_inrate);
     if (!upsampler->init(cutoff)) {
         SPDLOG_ERROR("Tx resampler failed to initialize");
@@ -132,15 +176,23 @@ bool RadioInterfaceResamp::init(int type) {
     }
 
     /*
-     * Allocate high and low rate buffers. The high rate receive
-     * buffer and low rate transmit vectors feed into the resampler
-     * and requires headroom equivalent to the filter length. Low
-     * rate buffers are allocated in the main radio interface code.
+     * Allocate high and low rate buffers. The resamplers keep their own
+     * filter history, so no headroom is needed ahead of their inputs.
+     * Low rate buffers are mirrored rings, the resamplers consume and fill
+     * them in place and the cursors wrap without moving any samples.
      */
-    m_inner_send_buffer = new signalVector(NUMCHUNKS * resamp_inchunk, upsampler->len());
+    if (!m_send_ring.init(NUMCHUNKS * resamp_inchunk * sizeof(std::complex<float>)) ||
+        !m_recv_ring.init(NUMCHUNKS * resamp_inchunk / m_sps_tx * sizeof(std::complex<float>))) {
+        SPDLOG_ERROR("Failed to map the low rate buffers");
+        return false;
+    }
+
+    m_inner_send_buffer = new signalVector((std::complex<float> *) m_send_ring.data(), 0,
+                                           m_send_ring.size() / sizeof(std::complex<float>));
     m_outer_send_buffer = new signalVector(NUMCHUNKS * resamp_outchunk);
-    m_inner_recv_buffer = new signalVector(NUMCHUNKS * resamp_inchunk / m_sps_tx);
-    m_outer_recv_buffer = new signalVector(resamp_outchunk, dnsampler->len());
+    m_inner_recv_buffer = new signalVector((std::complex<float> *) m_recv_ring.data(), 0,
+                                           m_recv_ring.size() / sizeof(std::complex<float>));
+    m_outer_recv_buffer = new signalVector(resamp_rx_outchunk);
 
 
     convertSendBuffer = new short[m_outer_send_buffer->size() * 2];
@@ -148,6 +200,12 @@ bool RadioInterfaceResamp::init(int type) {
 
     m_send_buffer = m_inner_send_buffer;
     m_recv_buffer = m_inner_recv_buffer;
+    m_recv_size = m_inner_recv_buffer->size();
+
+    m_send_start = 0;
+    m_send_cursor = 0;
+    m_recv_start = 0;
+    m_recv_cursor = 0;
 
     return true;
 }
@@ -162,19 +220,28 @@ void RadioInterfaceResamp::pullBuffer() {
     }
 
     /* Outer buffer access size is fixed */
-    num_recv = m_radio->readSamples(convertRecvBuffer, resamp_outchunk, &m_overrun, m_read_timestamp, &local_underrun);
-    if (num_recv != resamp_outchunk) {
+    num_recv = m_radio->readSamples(convertRecvBuffer, resamp_rx_outchunk, &m_overrun,
+                                    m_read_timestamp + resamp_rx_delay, &local_underrun);
+    if (num_recv != resamp_rx_outchunk) {
         SPDLOG_ERROR("Receive error {}", num_recv);
         return;
     }
 
-    convert_short_float((float *) m_outer_recv_buffer->begin(), convertRecvBuffer, 2 * resamp_outchunk);
+    convertRecvSamples((float *) m_outer_recv_buffer->begin(), convertRecvBuffer, resamp_rx_outchunk);
 
     m_underrun |= local_underrun;
-    m_read_timestamp += (TIMESTAMP) resamp_outchunk;
+    m_read_timestamp += (TIMESTAMP) resamp_rx_outchunk;
+
+    /* Decimate in place down to the rational stage input rate */
+    for (size_t i = 0; i < rx_halfbands.size(); i++) {
+        rc = rx_halfbands[i]->decimate((float *) m_outer_recv_buffer->begin(), resamp_rx_outchunk >> i, (float *) m_outer_recv_buffer->begin());
+        if (rc < 0) {
+            SPDLOG_ERROR("Half-band decimation error");
+        }
+    }
 
     /* Write to the end of the inner receive buffer */
-    rc = dnsampler->rotate((float *) m_outer_recv_buffer->begin(), resamp_outchunk, (float *) (m_inner_recv_buffer->begin() + m_recv_cursor), resamp_inchunk);
+    rc = dnsampler->rotate((float *) m_outer_recv_buffer->begin(), resamp_outchunk, (float *) (m_inner_recv_buffer->begin() + m_recv_start + m_recv_cursor), resamp_inchunk);
     if (rc < 0) {
         SPDLOG_ERROR("Sample rate upsampling error");
     }
@@ -182,6 +249,15 @@ void RadioInterfaceResamp::pullBuffer() {
     m_recv_cursor += resamp_inchunk;
 }
 
+/* The resampled receive buffer is already float, bursts are plain copies */
+void RadioInterfaceResamp::sliceRecvBuffer(unsigned offset, signalVector &burst) {
+    memcpy(burst.begin(), m_inner_recv_buffer->begin() + m_recv_start + offset, burst.size() * 2 * sizeof(float));
+}
+
+void RadioInterfaceResamp::consumeRecvBuffer(unsigned len) {
+    m_recv_start = (m_recv_start + len) % m_recv_size;
+}
+
 /* Send a timestamped chunk to the device */
 void RadioInterfaceResamp::pushBuffer() {
     int rc, chunks, num_sent;
@@ -200,8 +276,8 @@ void RadioInterfaceResamp::pushBuffer() {
     inner_len = chunks * resamp_inchunk;
     outer_len = chunks * resamp_outchunk;
 
-    /* Always send from the beginning of the buffer */
-    rc = upsampler->rotate((float *) m_inner_send_buffer->begin(), inner_len, (float *) m_outer_send_buffer->begin(), outer_len);
+    /* Send from the oldest sample in the ring */
+    rc = upsampler->rotate((float *) (m_inner_send_buffer->begin() + m_send_start), inner_len, (float *) m_outer_send_buffer->begin(), outer_len);
     if (rc < 0) {
         SPDLOG_ERROR("Sample rate downsampling error");
     }
@@ -213,8 +289,8 @@ void RadioInterfaceResamp::pushBuffer() {
         SPDLOG_ERROR("Transmit error {}", num_sent);
     }
 
-    /* Shift remaining samples to beginning of buffer */
-    memmove(m_inner_send_buffer->begin(), m_inner_send_buffer->begin() + inner_len, (m_send_cursor - inner_len) * 2 * sizeof(float));
+    /* Remaining samples stay in place, the ring start moves past the sent ones */
+    m_send_start = (m_send_start + inner_len) % m_inner_send_buffer->size();
 
     m_write_timestamp += outer_len;
     m_send_cursor -= inner_len;
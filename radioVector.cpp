@@ -1,9 +1,170 @@
 #include "radioVector.h"
 
+#include <algorithm>
+#include <cstddef>
+
 radioVector::radioVector(const signalVector &wVector, GsmTime &wTime)
         : signalVector(wVector), mTime(wTime) {
 }
 
+radioVector::radioVector(size_t size, size_t head, size_t tail, GsmTime &wTime)
+        : signalVector(size, head, tail), mTime(wTime) {
+}
+
+radioVector::radioVector(GsmTime &wTime, size_t len)
+        : mTime(wTime), mDevice(2 * len) {
+}
+
+/*
+ * Bursts come in a handful of fixed shapes, the receive slots at 156 and 157
+ * samples per sps and the transmit slots with their guard periods. Each shape
+ * gets a fixed capacity free list so bursts cycle between the radio, queue
+ * and demodulation threads without touching the heap in steady state. Shapes
+ * beyond BURST_POOL_SHAPES and bursts beyond BURST_POOL_DEPTH fall back to
+ * plain new and delete.
+ */
+#define BURST_POOL_SHAPES 8
+#define BURST_POOL_DEPTH  64
+
+struct BurstShape {
+    size_t size;
+    size_t head;
+    size_t tail;
+    bool device;
+
+    bool operator==(const BurstShape &other) const = default;
+};
+
+struct BurstPool {
+    BurstShape shape;
+    radioVector * free[BURST_POOL_DEPTH];
+    int count;
+};
+
+static BurstPool burstPools[BURST_POOL_SHAPES];
+static int burstPoolShapes = 0;
+static Mutex burstPoolLock;
+
+/* Pop a burst of the shape, claiming a pool for a new shape */
+static radioVector * burstPoolGet(const BurstShape &shape) {
+    ScopedLock lock(burstPoolLock);
+
+    for (int i = 0; i < burstPoolShapes; i++) {
+        if (burstPools[i].shape == shape)
+            return burstPools[i].count ? burstPools[i].free[--burstPools[i].count] : nullptr;
+    }
+
+    if (burstPoolShapes < BURST_POOL_SHAPES) {
+        burstPools[burstPoolShapes].shape = shape;
+        burstPools[burstPoolShapes].count = 0;
+        burstPoolShapes++;
+    }
+
+    return nullptr;
+}
+
+static bool burstPoolPut(const BurstShape &shape, radioVector * burst) {
+    ScopedLock lock(burstPoolLock);
+
+    for (int i = 0; i < burstPoolShapes; i++) {
+        if (burstPools[i].shape == shape) {
+            if (burstPools[i].count == BURST_POOL_DEPTH)
+                return false;
+            burstPools[i].free[burstPools[i].count++] = burst;
+            return true;
+        }
+    }
+
+    return false;
+}
+
+radioVector * radioVector::make(size_t size, size_t head, size_t tail, GsmTime &wTime) {
+    radioVector * burst = burstPoolGet({size, head, tail, false});
+    if (!burst)
+        return new radioVector(size, head, tail, wTime);
+
+    std::fill(burst->begin() - head, burst->end() + tail, std::complex<float>(0.0f));
+    burst->setTime(wTime);
+
+    return burst;
+}
+
+radioVector * radioVector::makeDevice(GsmTime &wTime, size_t len) {
+    radioVector * burst = burstPoolGet({len, 0, 0, true});
+    if (!burst)
+        return new radioVector(wTime, len);
+
+    burst->setTime(wTime);
+
+    return burst;
+}
+
+void radioVector::recycle(radioVector * burst) {
+    BurstShape shape;
+
+    if (burst->isDeviceFormat())
+        shape = {burst->burstLength(), 0, 0, true};
+    else
+        shape = {burst->size(), burst->headroom(), burst->tailroom(), false};
+
+    if (!burstPoolPut(shape, burst))
+        delete burst;
+}
+
+/*
+ * Shared bursts carry a reference count in a control block of their own.
+ * Those blocks all have the same size and cycle through one free list, so
+ * sharing a burst does not touch the heap in steady state either.
+ */
+#define SHARE_POOL_DEPTH  1024
+#define SHARE_BLOCK_SIZE  64
+
+static void * shareBlocks[SHARE_POOL_DEPTH];
+static int shareBlockCount = 0;
+static Mutex shareBlockLock;
+
+template <typename T>
+struct ShareAllocator {
+    using value_type = T;
+
+    ShareAllocator() = default;
+
+    template <typename U>
+    ShareAllocator(const ShareAllocator<U> &) {}
+
+    T * allocate(size_t n) {
+        static_assert((sizeof(T) <= SHARE_BLOCK_SIZE) && (alignof(T) <= alignof(std::max_align_t)));
+
+        if (n != 1)
+            return (T *) ::operator new(n * sizeof(T));
+
+        ScopedLock lock(shareBlockLock);
+        if (shareBlockCount)
+            return (T *) shareBlocks[--shareBlockCount];
+
+        return (T *) ::operator new(SHARE_BLOCK_SIZE);
+    }
+
+    void deallocate(T * p, size_t n) {
+        if (n == 1) {
+            ScopedLock lock(shareBlockLock);
+            if (shareBlockCount < SHARE_POOL_DEPTH) {
+                shareBlocks[shareBlockCount++] = p;
+                return;
+            }
+        }
+
+        ::operator delete(p);
+    }
+
+    template <typename U>
+    bool operator==(const ShareAllocator<U> &) const { return true; }
+};
+
+std::shared_ptr<const radioVector> radioVector::share(radioVector * burst) {
+    return std::shared_ptr<const radioVector>(burst, radioVector::recycle, ShareAllocator<radioVector>());
+}
+
 GsmTime radioVector::getTime() const {
     return mTime;
 }
@@ -22,6 +22,7 @@
 #ifndef RADIOVECTOR_H
 #define RADIOVECTOR_H
 
+#include <memory>
 #include <vector>
 
 
@@ -35,6 +36,34 @@ class radioVector : public signalVector {
 public:
     radioVector(const signalVector &wVector, GsmTime &wTime);
 
+    /** Allocate an empty burst with zeroed guard space, see signalVector(size, start, tail) */
+    radioVector(size_t size, size_t head, size_t tail, GsmTime &wTime);
+
+    /** Allocate a burst of len samples held only as interleaved 16-bit device samples */
+    radioVector(GsmTime &wTime, size_t len);
+
+    /** Take a zeroed burst from the burst pool, see radioVector(size, head, tail, time) */
+    static radioVector * make(size_t size, size_t head, size_t tail, GsmTime &wTime);
+
+    /** Take a device format burst from the burst pool, see radioVector(time, len) */
+    static radioVector * makeDevice(GsmTime &wTime, size_t len);
+
+    /** Return a burst to the burst pool, or delete it if the pool is full */
+    static void recycle(radioVector * burst);
+
+    /** Share a burst, its reference count is also taken from a pool and the last owner recycles it */
+    static std::shared_ptr<const radioVector> share(radioVector * burst);
+
+    /** whether the burst is held as device samples rather than complex float */
+    [[nodiscard]] bool isDeviceFormat() const { return !mDevice.empty(); }
+
+    /** interleaved device samples of a device format burst */
+    short * deviceSamples() { return mDevice.data(); }
+    [[nodiscard]] const short * deviceSamples() const { return mDevice.data(); }
+
+    /** burst length in samples, in either format */
+    [[nodiscard]] size_t burstLength() const { return isDeviceFormat() ? mDevice.size() / 2 : size(); }
+
     [[nodiscard]] GsmTime getTime() const;
 
     void setTime(const GsmTime &wTime);
@@ -43,6 +72,7 @@ public:
 
 private:
     GsmTime mTime;
+    std::vector<short> mDevice;
 };
 
 class noiseVector : std::vector<float> {
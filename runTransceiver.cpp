@@ -52,6 +52,12 @@ int main(int argc, char *argv[]) {
 
     std::string clock_reference_str = "internal";
 
+    // Transmit sample format, "int16" keeps bursts in device format from modulation on
+    std::string tx_format_str = "float";
+
+    // Receive DC offset removal, "on" subtracts a running I/Q offset estimate during conversion
+    std::string rx_dc_removal_str = "off";
+
     /*** Setup Logger ***/
     // create color console logger if enabled
     if (log_type == "console") {
@@ -150,9 +156,21 @@ int main(int argc, char *argv[]) {
         failure = true;
     }
 
+    if (!failure && (rx_dc_removal_str == "on")) {
+        radio->setDCRemoval(true);
+        SPDLOG_INFO("Receive DC Removal: On");
+    }
+
     Transceiver *trx = nullptr;
     if (!failure) {
         trx = new Transceiver(trxPort, trxAddr.c_str(), 4, GsmTime(3, 0), radio);
+        if (tx_format_str == "int16") {
+            if (trx->setTxDeviceFormat(true)) {
+                SPDLOG_INFO("Transmit Format: int16");
+            } else {
+                SPDLOG_WARN("Transmit Format: int16 is not supported with resampling, using float");
+            }
+        }
         if (!trx->init()) {
             SPDLOG_ERROR("Failed to initialize transceiver");
             failure = true;
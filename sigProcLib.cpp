@@ -1,5 +1,9 @@
+#include <algorithm>
+
 #include "sigProcLib.h"
 
+#define SPDLOG_ACTIVE_LEVEL SPDLOG_LEVEL_DEBUG
+#include "spdlog/spdlog.h"
 
 #include "BitVector.h"
 
@@ -7,6 +11,8 @@
 
 extern "C" {
 #include "convolve.h"
+#include "vecops.h"
+#include "trellis.h"
 }
 
 // FIXME: Externs copied from GSMCommon.h
@@ -40,6 +46,16 @@ static const float M_PI_F = (float) M_PI;
 static const float M_2PI_F = (float) (2.0 * M_PI);
 static const float M_1_2PI_F = 1 / M_2PI_F;
 
+/*
+ * Fractional interpolation table for the sub-sample peak estimator. Each
+ * phase holds the sinc taps used by interpolatePoint() for a fractional
+ * index of phase / PEAK_PHASES, and points in between blend two phases.
+ */
+#define PEAK_TAPS 21
+#define PEAK_PHASES 64
+static float peakTable[PEAK_PHASES + 1][PEAK_TAPS];
+static PeakEstimator peakEstimator = PEAK_SECANT;
+
 /* Precomputed rotation vectors */
 static signalVector * GMSKRotationN = nullptr;
 static signalVector * GMSKReverseRotationN = nullptr;
@@ -58,14 +74,29 @@ struct CorrelationSequence {
     ~CorrelationSequence() {
         delete sequence;
         free(buffer);
+        delete[] estimator;
     }
 
     signalVector * sequence = nullptr;
     void * buffer = nullptr;
     float toa = 0.0;
     std::complex<float> gain;
+    std::complex<float> * estimator = nullptr;
 };
 
+/*
+ * Least squares channel estimation over the 26 symbol midamble of a normal
+ * burst. The estimate has CHAN_EST_TAPS symbol spaced taps, CHAN_EST_LEAD of
+ * them ahead of the correlation peak, and is taken from the CHAN_EST_LEN
+ * midamble samples whose taps all fall on known symbols. The estimator is
+ * the pseudo-inverse of the midamble convolution matrix, one row per tap.
+ */
+#define MIDAMBLE_START 61
+#define MIDAMBLE_LEN 26
+#define CHAN_EST_TAPS 7
+#define CHAN_EST_LEAD 3
+#define CHAN_EST_LEN (MIDAMBLE_LEN - CHAN_EST_TAPS + 1)
+
 /*
  * Gaussian and empty modulation pulses. Like the correlation sequences,
  * store the runtime (Gaussian) buffer separately because of needed alignment
@@ -80,6 +111,7 @@ struct PulseSequence {
         delete empty;
         free(c0_buffer);
         free(c1_buffer);
+        delete[] table;
     }
 
     signalVector * c0 = nullptr;
@@ -87,12 +119,34 @@ struct PulseSequence {
     signalVector * empty = nullptr;
     void * c0_buffer = nullptr;
     void * c1_buffer = nullptr;
+    std::complex<float> * table = nullptr;
+};
+
+/*
+ * Fractional delay filterbank with one sinc interpolator per phase of a
+ * sample. All phases share a single aligned tap buffer.
+ */
+#define DELAY_FILT_LEN 20
+#define DELAY_PHASES 128
+
+struct DelayFilterBank {
+    DelayFilterBank() = default;
+
+    ~DelayFilterBank() {
+        for (int i = 0; i < DELAY_PHASES; i++)
+            delete filters[i];
+        free(buffer);
+    }
+
+    signalVector * filters[DELAY_PHASES] = {};
+    void * buffer = nullptr;
 };
 
 CorrelationSequence * gMidambles[] = {nullptr, nullptr, nullptr, nullptr, nullptr, nullptr, nullptr, nullptr};
 CorrelationSequence * gRACHSequence = nullptr;
 PulseSequence * GSMPulse = nullptr;
 PulseSequence * GSMPulse1 = nullptr;
+DelayFilterBank * gDelayFilters = nullptr;
 
 void sigProcLibDestroy() {
     for (int i = 0; i < 8; i++) {
@@ -107,6 +161,7 @@ void sigProcLibDestroy() {
     delete gRACHSequence;
     delete GSMPulse;
     delete GSMPulse1;
+    delete gDelayFilters;
 
     GMSKRotationN = nullptr;
     GMSKRotation1 = nullptr;
@@ -115,6 +170,7 @@ void sigProcLibDestroy() {
     gRACHSequence = nullptr;
     GSMPulse = nullptr;
     GSMPulse1 = nullptr;
+    gDelayFilters = nullptr;
 }
 
 // dB relative to 1.0.
@@ -178,13 +234,7 @@ float dBinv(float x) {
 }
 
 float vectorNorm2(const signalVector &x) {
-    signalVector::const_iterator xPtr = x.begin();
-    float Energy = 0.0;
-    for (; xPtr != x.end(); xPtr++) {
-        //Energy += xPtr->norm2();
-        Energy += std::norm(*xPtr);
-    }
-    return Energy;
+    return vec_norm2((const float *) x.begin(), x.size());
 }
 
 
@@ -267,50 +317,32 @@ void initGMSKRotationTables(int sps) {
 }
 
 static void GMSKRotate(signalVector &x, int sps) {
-    signalVector::iterator rotPtr, xPtr = x.begin();
+    signalVector * rot = (sps == 1) ? GMSKRotation1 : GMSKRotationN;
 
-    if (sps == 1)
-        rotPtr = GMSKRotation1->begin();
+    if (x.isRealOnly())
+        vec_mul_real((float *) x.begin(), (float *) rot->begin(), x.size());
     else
-        rotPtr = GMSKRotationN->begin();
-
-    if (x.isRealOnly()) {
-        while (xPtr < x.end()) {
-            *xPtr = *rotPtr++ * (xPtr->real());
-            xPtr++;
-        }
-    } else {
-        while (xPtr < x.end()) {
-            *xPtr = *rotPtr++ * (*xPtr);
-            xPtr++;
-        }
-    }
+        vec_mul((float *) x.begin(), (float *) rot->begin(), x.size());
 }
 
-static void GMSKReverseRotate(signalVector &x, int sps) {
-    signalVector::iterator rotPtr, xPtr = x.begin();
-
-    if (sps == 1)
-        rotPtr = GMSKReverseRotation1->begin();
-    else
-        rotPtr = GMSKReverseRotationN->begin();
+/* Reverse rotation with an optional complex scale fused into the same pass */
+static void GMSKReverseRotate(signalVector &x, int sps, std::complex<float> scale = 1.0f) {
+    signalVector * rot = (sps == 1) ? GMSKReverseRotation1 : GMSKReverseRotationN;
 
     if (x.isRealOnly()) {
-        while (xPtr < x.end()) {
-            *xPtr = *rotPtr++ * (xPtr->real());
-            xPtr++;
-        }
+        vec_mul_real((float *) x.begin(), (float *) rot->begin(), x.size());
+        if (scale != 1.0f)
+            vec_scale((float *) x.begin(), (float *) &scale, x.size());
+    } else if (scale != 1.0f) {
+        vec_scale_mul((float *) x.begin(), (float *) &scale, (float *) rot->begin(), x.size());
     } else {
-        while (xPtr < x.end()) {
-            *xPtr = *rotPtr++ * (*xPtr);
-            xPtr++;
-        }
+        vec_mul((float *) x.begin(), (float *) rot->begin(), x.size());
     }
 }
 
 signalVector * convolve(const signalVector * x, const signalVector * h, signalVector * y,
                         ConvType spanType, int start, unsigned len, unsigned step, int offset) {
-    int rc, head = 0, tail = 0;
+    int rc, head = 0, tail = 0, x_len;
     bool alloc = false, append = false;
     const signalVector * _x = NULL;
 
@@ -356,11 +388,18 @@ signalVector * convolve(const signalVector * x, const signalVector * h, signalVe
         alloc = true;
     }
 
-    /* Prepend or post-pend the input vector if the parameters require it */
-    if (append)
+    /*
+     * Prepend or post-pend the input vector if the parameters require it.
+     * Inputs allocated with enough zeroed guard space are read in place.
+     */
+    if (append && (x->headroom() < (size_t) head || x->tailroom() < (size_t) tail)) {
         _x = new signalVector(*x, head, tail);
-    else
+        x_len = _x->size();
+    } else {
         _x = x;
+        x_len = x->size() + tail;
+        append = false;
+    }
 
     /*
      * Four convovle types:
@@ -370,22 +409,22 @@ signalVector * convolve(const signalVector * x, const signalVector * h, signalVe
      *   4. Complex-Complex (!aligned)
      */
     if (h->isRealOnly() && h->isAligned()) {
-        rc = convolve_real((float *) _x->begin(), _x->size(),
+        rc = convolve_real((float *) _x->begin(), x_len,
                            (float *) h->begin(), h->size(),
                            (float *) y->begin(), y->size(),
                            start, len, step, offset);
     } else if (!h->isRealOnly() && h->isAligned()) {
-        rc = convolve_complex((float *) _x->begin(), _x->size(),
+        rc = convolve_complex((float *) _x->begin(), x_len,
                               (float *) h->begin(), h->size(),
                               (float *) y->begin(), y->size(),
                               start, len, step, offset);
     } else if (h->isRealOnly() && !h->isAligned()) {
-        rc = base_convolve_real((float *) _x->begin(), _x->size(),
+        rc = base_convolve_real((float *) _x->begin(), x_len,
                                 (float *) h->begin(), h->size(),
                                 (float *) y->begin(), y->size(),
                                 start, len, step, offset);
     } else if (!h->isRealOnly() && !h->isAligned()) {
-        rc = base_convolve_complex((float *) _x->begin(), _x->size(),
+        rc = base_convolve_complex((float *) _x->begin(), x_len,
                                    (float *) h->begin(), h->size(),
                                    (float *) y->begin(), y->size(),
                                    start, len, step, offset);
@@ -444,6 +483,122 @@ static bool generateC1Pulse(int sps, PulseSequence * pulse) {
     return true;
 }
 
+/*
+ * Table driven modulation. Away from the burst edges each block of sps
+ * output samples depends only on the last MOD_WINDOW symbols, which covers
+ * the C0 pulse, the C1 pulse and its differential phase. Blocks are stored
+ * for every bit pattern of the window and rotated by j^t at block t.
+ */
+#define MOD_WINDOW 4
+#define MOD_PATTERNS (1 << MOD_WINDOW)
+#define MOD_MAX_SPS 4
+
+/* Powers of j for the symbol spaced GMSK rotation */
+static std::complex<float> jpow(int n) {
+    switch (n & 3) {
+        case 0:
+            return {1.0f, 0.0f};
+        case 1:
+            return {0.0f, 1.0f};
+        case 2:
+            return {-1.0f, 0.0f};
+        default:
+            return {0.0f, -1.0f};
+    }
+}
+
+/* Sum the C0 and C1 pulse responses of the window ending at symbol t into block t */
+template<typename Sym0, typename Sym1>
+static void modulateBlock(const PulseSequence * pulse, int sps, Sym0 sym0, Sym1 sym1, int t,
+                          std::complex<float> * out) {
+    int c0_len = pulse->c0->size();
+    int c1_len = pulse->c1 ? pulse->c1->size() : 0;
+
+    for (int r = 0; r < sps; r++) {
+        std::complex<float> val = 0.0f;
+
+        for (int s = t - MOD_WINDOW + 1; s <= t; s++) {
+            int k = (s - t) * sps - r + c0_len - 1;
+            if ((k >= 0) && (k < c0_len))
+                val += sym0(s) * (*pulse->c0)[k].real();
+
+            k = (s - t) * sps - r + c1_len - 1;
+            if ((k >= 0) && (k < c1_len))
+                val += sym1(s) * (*pulse->c1)[k].real();
+        }
+
+        out[r] = val;
+    }
+}
+
+/*
+ * C1 symbol value of the dual pulse Laurent modulator, where amp(s) is the
+ * +/-1 amplitude of symbol s. C1 carries the differential phase of the two
+ * preceding symbols.
+ */
+template<typename Amp>
+static std::complex<float> laurentC1(Amp amp, int s) {
+    return amp(s) * jpow(s) * std::complex<float>(0.0f, -amp(s - 1) * amp(s - 2));
+}
+
+static void generateModulatorTable(int sps, PulseSequence * pulse) {
+    pulse->table = new std::complex<float>[MOD_PATTERNS * sps];
+
+    for (int p = 0; p < MOD_PATTERNS; p++) {
+        /* Window of symbols -MOD_WINDOW + 1 through 0 */
+        auto amp = [p](int s) { return (p >> (s + MOD_WINDOW - 1)) & 0x01 ? 1.0f : -1.0f; };
+        auto sym0 = [amp](int s) { return amp(s) * jpow(s); };
+        auto sym1 = [amp](int s) {
+            return s > -MOD_WINDOW + 2 ? laurentC1(amp, s) : std::complex<float>(0.0f);
+        };
+
+        modulateBlock(pulse, sps, sym0, sym1, 0, &pulse->table[p * sps]);
+    }
+}
+
+/*
+ * Modulate the blocks covered by symbols 0 through last, scaled, and zero
+ * the rest of the len sample burst. Blocks first through last are looked up
+ * by the pattern of amp() over their window, the edge blocks are summed
+ * directly. Samples are written through store(i, val), so the same modulator
+ * produces float or device format bursts.
+ */
+template<typename Amp, typename Sym0, typename Sym1, typename Store>
+static void modulateTable(const PulseSequence * pulse, int sps, Amp amp, Sym0 sym0, Sym1 sym1,
+                          int first, int last, size_t len, Store store, std::complex<float> scale) {
+    std::complex<float> block[MOD_MAX_SPS];
+    int blocks = std::min(last + MOD_WINDOW - 1, (int) len / sps - 1);
+
+    /* Shift register of the window amplitudes, newest symbol in the top bit */
+    int p = 0;
+
+    for (int t = 0; t <= blocks; t++) {
+        if (t <= last)
+            p = (p >> 1) | ((amp(t) > 0.0f) << (MOD_WINDOW - 1));
+
+        if ((t < first) || (t > last)) {
+            modulateBlock(pulse, sps, sym0, sym1, t, block);
+            for (int r = 0; r < sps; r++)
+                store(t * sps + r, block[r] * scale);
+            continue;
+        }
+
+        /* Rotation by j^t and the scale combine into one complex gain per block */
+        std::complex<float> rot = jpow(t);
+        rot = {rot.real() * scale.real() - rot.imag() * scale.imag(),
+               rot.real() * scale.imag() + rot.imag() * scale.real()};
+
+        const std::complex<float> * entry = &pulse->table[p * sps];
+        for (int r = 0; r < sps; r++) {
+            store(t * sps + r, {entry[r].real() * rot.real() - entry[r].imag() * rot.imag(),
+                                entry[r].real() * rot.imag() + entry[r].imag() * rot.real()});
+        }
+    }
+
+    for (size_t i = (blocks + 1) * sps; i < len; i++)
+        store(i, std::complex<float>(0.0f));
+}
+
 static PulseSequence * generateGSMPulse(int sps, int symbolLength) {
     int len;
     float arg, avg, center;
@@ -498,6 +653,7 @@ static PulseSequence * generateGSMPulse(int sps, int symbolLength) {
         *xP++ = 2.84385729e-02;
         *xP++ = 4.46348606e-03;
         generateC1Pulse(sps, pulse);
+        generateModulatorTable(sps, pulse);
     } else {
         center = (float) (len - 1.0) / 2.0;
 
@@ -512,6 +668,8 @@ static PulseSequence * generateGSMPulse(int sps, int symbolLength) {
         xP = pulse->c0->begin();
         for (int i = 0; i < len; i++)
             *xP++ /= avg;
+
+        generateModulatorTable(sps, pulse);
     }
 
     return pulse;
@@ -596,12 +754,14 @@ bool vectorSlicer(signalVector * x) {
 
 static signalVector * rotateBurst(const BitVector &wBurst, int guardPeriodLength, int sps) {
     int burst_len;
-    signalVector * pulse, rotated, * shaped;
+    signalVector * pulse, * shaped;
     signalVector::iterator itr;
 
     pulse = GSMPulse1->empty;
     burst_len = sps * (wBurst.size() + guardPeriodLength);
-    rotated = signalVector(burst_len);
+
+    /* Allocate the pulse span as headroom so the filter reads in place */
+    signalVector rotated(burst_len, pulse->size());
     itr = rotated.begin();
 
     for (unsigned i = 0; i < wBurst.size(); i++) {
@@ -620,127 +780,96 @@ static signalVector * rotateBurst(const BitVector &wBurst, int guardPeriodLength
     return shaped;
 }
 
-static signalVector * modulateBurstLaurent(const BitVector &bits, int guard_len, int sps) {
-    int burst_len;
-    float phase;
-    signalVector * c0_pulse, * c1_pulse, c0_burst, c1_burst, * c0_shaped, * c1_shaped;
-    signalVector::iterator c0_itr, c1_itr;
+template<typename Store>
+static void modulateBurstLaurent(const BitVector &bits, int sps, size_t len, Store store,
+                                 std::complex<float> scale) {
+    int last;
+
+    /* Padded differential start and end bits around the burst bits */
+    last = bits.size() + 1;
+    auto amp = [&bits, last](int s) {
+        if (s == 0)
+            return -1.0f;
+        if (s == last)
+            return 1.0f;
+        return 2.0f * (bits[s - 1] & 0x01) - 1.0f;
+    };
+    auto sym0 = [amp, last](int s) {
+        return ((s < 0) || (s > last)) ? std::complex<float>(0.0f) : amp(s) * jpow(s);
+    };
+
+    /* C1 starts on the third symbol with a fixed phase */
+    auto sym1 = [amp, last](int s) {
+        if ((s < 2) || (s > last))
+            return std::complex<float>(0.0f);
+        if (s == 2)
+            return amp(s) * jpow(s) * std::complex<float>(0.0f, -1.0f);
+        return laurentC1(amp, s);
+    };
+
+    modulateTable(GSMPulse, sps, amp, sym0, sym1, MOD_WINDOW, last, len, store, scale);
+}
+
+template<typename Store>
+static void modulateBurstBasic(const BitVector &bits, int sps, size_t len, Store store,
+                               std::complex<float> scale) {
+    int last;
+
+    /* Raw bits are not differentially encoded */
+    last = bits.size() - 1;
+    auto amp = [&bits](int s) { return 2.0f * (bits[s] & 0x01) - 1.0f; };
+    auto sym0 = [amp, last](int s) {
+        return ((s < 0) || (s > last)) ? std::complex<float>(0.0f) : amp(s) * jpow(s);
+    };
+    auto sym1 = [](int) { return std::complex<float>(0.0f); };
+
+    /* Only reached at 1 sps, the 4 sps table includes the C1 pulse */
+    modulateTable(GSMPulse1, sps, amp, sym0, sym1, MOD_WINDOW - 1, last, len, store, scale);
+}
+
+/* Assume input bits are not differentially encoded */
+signalVector * modulateBurst(const BitVector &wBurst, int guardPeriodLength, int sps, bool emptyPulse) {
+    if (emptyPulse)
+        return rotateBurst(wBurst, guardPeriodLength, sps);
 
     /*
      * Apply before and after bits to reduce phase error at burst edges.
      * Make sure there is enough room in the burst to accomodate all bits.
      */
-    if (guard_len < 4)
-        guard_len = 4;
-
-    c0_pulse = GSMPulse->c0;
-    c1_pulse = GSMPulse->c1;
-
-    burst_len = sps * (bits.size() + guard_len);
-
-    c0_burst = signalVector(burst_len);
-    c0_burst.isRealOnly(true);
-    c0_itr = c0_burst.begin();
-
-    c1_burst = signalVector(burst_len);
-    c1_burst.isRealOnly(true);
-    c1_itr = c1_burst.begin();
-
-    /* Padded differential start bits */
-    *c0_itr = 2.0 * (0x00 & 0x01) - 1.0;
-    c0_itr += sps;
-
-    /* Main burst bits */
-    for (unsigned i = 0; i < bits.size(); i++) {
-        *c0_itr = 2.0 * (bits[i] & 0x01) - 1.0;
-        c0_itr += sps;
-    }
-
-    /* Padded differential end bits */
-    *c0_itr = 2.0 * (0x01 & 0x01) - 1.0;
-
-    /* Generate C0 phase coefficients */
-    GMSKRotate(c0_burst, sps);
-    c0_burst.isRealOnly(false);
-
-    c0_itr = c0_burst.begin();
-    c0_itr += sps * 2;
-    c1_itr += sps * 2;
-
-    /* Start magic */
-    phase = 2.0 * ((0x01 & 0x01) ^ (0x01 & 0x01)) - 1.0;
-    *c1_itr = *c0_itr * std::complex<float>(0, phase);
-    c0_itr += sps;
-    c1_itr += sps;
-
-    /* Generate C1 phase coefficients */
-    for (unsigned i = 2; i < bits.size(); i++) {
-        phase = 2.0 * ((bits[i - 1] & 0x01) ^ (bits[i - 2] & 0x01)) - 1.0;
-        *c1_itr = *c0_itr * std::complex<float>(0, phase);
+    if ((sps == 4) && (guardPeriodLength < 4))
+        guardPeriodLength = 4;
 
-        c0_itr += sps;
-        c1_itr += sps;
-    }
-
-    /* End magic */
-    int i = bits.size();
-    phase = 2.0 * ((bits[i - 1] & 0x01) ^ (bits[i - 2] & 0x01)) - 1.0;
-    *c1_itr = *c0_itr * std::complex<float>(0, phase);
-
-    /* Primary (C0) and secondary (C1) pulse shaping */
-    c0_shaped = convolve(&c0_burst, c0_pulse, nullptr, START_ONLY);
-    c1_shaped = convolve(&c1_burst, c1_pulse, nullptr, START_ONLY);
+    signalVector * burst = new signalVector(sps * (wBurst.size() + guardPeriodLength));
+    modulateBurst(wBurst, sps, *burst);
 
-    /* Sum shaped outputs into C0 */
-    c0_itr = c0_shaped->begin();
-    c1_itr = c1_shaped->begin();
-    for (unsigned i = 0; i < c0_shaped->size(); i++)
-        *c0_itr++ += *c1_itr++;
-
-    delete c1_shaped;
-
-    return c0_shaped;
+    return burst;
 }
 
-static signalVector * modulateBurstBasic(const BitVector &bits, int guard_len, int sps) {
-    int burst_len;
-    signalVector * pulse, burst, * shaped;
-    signalVector::iterator burst_itr;
+void modulateBurst(const BitVector &wBurst, int sps, signalVector &out, std::complex<float> scale) {
+    std::complex<float> * data = out.begin();
+    auto store = [data](size_t i, std::complex<float> val) { data[i] = val; };
 
-    if (sps == 1)
-        pulse = GSMPulse1->c0;
+    if (sps == 4)
+        modulateBurstLaurent(wBurst, sps, out.size(), store, scale);
     else
-        pulse = GSMPulse->c0;
-
-    burst_len = sps * (bits.size() + guard_len);
-
-    burst = signalVector(burst_len);
-    burst.isRealOnly(true);
-    burst_itr = burst.begin();
-
-    /* Raw bits are not differentially encoded */
-    for (unsigned i = 0; i < bits.size(); i++) {
-        *burst_itr = 2.0 * (bits[i] & 0x01) - 1.0;
-        burst_itr += sps;
-    }
-
-    GMSKRotate(burst, sps);
-    burst.isRealOnly(false);
-
-    /* Single Gaussian pulse approximation shaping */
-    shaped = convolve(&burst, pulse, NULL, START_ONLY);
+        modulateBurstBasic(wBurst, sps, out.size(), store, scale);
+}
 
-    return shaped;
+/* Saturate a scaled sample to the 16-bit device range */
+static inline short saturateShort(float val) {
+    return (short) lrintf(std::clamp(val, -32768.0f, 32767.0f));
 }
 
-/* Assume input bits are not differentially encoded */
-signalVector * modulateBurst(const BitVector &wBurst, int guardPeriodLength, int sps, bool emptyPulse) {
-    if (emptyPulse)
-        return rotateBurst(wBurst, guardPeriodLength, sps);
-    else if (sps == 4)
-        return modulateBurstLaurent(wBurst, guardPeriodLength, sps);
+void modulateBurst(const BitVector &wBurst, int sps, short * out, size_t len, float scale) {
+    auto store = [out](size_t i, std::complex<float> val) {
+        out[2 * i + 0] = saturateShort(val.real());
+        out[2 * i + 1] = saturateShort(val.imag());
+    };
+
+    if (sps == 4)
+        modulateBurstLaurent(wBurst, sps, len, store, scale);
     else
-        return modulateBurstBasic(wBurst, guardPeriodLength, sps);
+        modulateBurstBasic(wBurst, sps, len, store, scale);
 }
 
 float sinc(float x) {
@@ -748,59 +877,82 @@ float sinc(float x) {
     return 1.0F;
 }
 
-bool delayVector(signalVector &wBurst, float delay) {
-    int whole, h_len = 20;
-    float frac;
-    std::complex<float> * data;
-    signalVector * h, * shift;
-    signalVector::iterator itr;
-
-    whole = floor(delay);
-    frac = delay - whole;
-
-    /* Sinc interpolated fractional shift (if allowable) */
-    if (fabs(frac) > 1e-2) {
-        data = (std::complex<float> *) convolve_h_alloc(h_len);
-        h = new signalVector(data, 0, h_len);
+/*
+ * Fractional delay by sinc interpolation followed by the integer sample
+ * shift. The scale is applied while the shifted samples are written back,
+ * so it costs no extra pass over the burst when a fractional shift is done.
+ */
+static DelayFilterBank * generateDelayFilters() {
+    DelayFilterBank * bank = new DelayFilterBank();
+    bank->buffer = convolve_h_alloc(DELAY_PHASES * DELAY_FILT_LEN);
+
+    /* Phase zero is a whole sample shift and is never filtered */
+    for (int p = 1; p < DELAY_PHASES; p++) {
+        float frac = (float) p / DELAY_PHASES;
+        signalVector * h = new signalVector((std::complex<float> *) bank->buffer,
+                                            p * DELAY_FILT_LEN, DELAY_FILT_LEN);
         h->setAligned(true);
         h->isRealOnly(true);
 
-        itr = h->end();
-        for (int i = 0; i < h_len; i++)
-            *--itr = (std::complex<float>) sinc(M_PI_F * (i - h_len / 2 - frac));
+        signalVector::iterator itr = h->end();
+        for (int i = 0; i < DELAY_FILT_LEN; i++)
+            *--itr = (std::complex<float>) sinc(M_PI_F * (i - DELAY_FILT_LEN / 2 - frac));
 
-        shift = convolve(&wBurst, h, NULL, NO_DELAY);
+        bank->filters[p] = h;
+    }
 
-        delete h;
-        free(data);
+    return bank;
+}
+
+/* Split a delay into whole samples and the nearest filterbank phase */
+static void delayPhase(float delay, int &whole, int &phase) {
+    whole = floor(delay);
+    phase = (int) lrintf((delay - whole) * DELAY_PHASES);
+    if (phase == DELAY_PHASES) {
+        whole++;
+        phase = 0;
+    }
+}
+
+bool delayVector(signalVector &wBurst, float delay, std::complex<float> scale) {
+    int whole, phase, src, dst, num;
+    signalVector * shift = nullptr;
+
+    delayPhase(delay, whole, phase);
 
+    /* Sinc interpolated fractional shift into per-thread scratch space */
+    if (phase) {
+        static thread_local signalVector scratch;
+        if (scratch.size() < wBurst.size())
+            scratch.resize(wBurst.size());
+
+        shift = convolve(&wBurst, gDelayFilters->filters[phase], &scratch, NO_DELAY);
         if (!shift)
             return false;
-
-        wBurst.clone(*shift);
-        delete shift;
     }
 
     /* Integer sample shift */
-    if (whole < 0) {
-        whole = -whole;
-        signalVector::iterator wBurstItr = wBurst.begin();
-        signalVector::iterator shiftedItr = wBurst.begin() + whole;
-
-        while (shiftedItr < wBurst.end())
-            *wBurstItr++ = *shiftedItr++;
-        while (wBurstItr < wBurst.end())
-            *wBurstItr++ = 0.0;
-    } else {
-        signalVector::iterator wBurstItr = wBurst.end() - 1;
-        signalVector::iterator shiftedItr = wBurst.end() - 1 - whole;
+    src = whole < 0 ? -whole : 0;
+    dst = whole < 0 ? 0 : whole;
+    num = (int) wBurst.size() - abs(whole);
+    if (num < 0)
+        num = 0;
 
-        while (shiftedItr >= wBurst.begin())
-            *wBurstItr-- = *shiftedItr--;
-        while (wBurstItr >= wBurst.begin())
-            *wBurstItr-- = 0.0;
+    float * out = (float *) wBurst.begin();
+
+    if (shift) {
+        vec_scale_copy(&out[2 * dst], (float *) (shift->begin() + src), (float *) &scale, num);
+    } else {
+        if (scale != 1.0f)
+            vec_scale(&out[2 * src], (float *) &scale, num);
+        memmove(&out[2 * dst], &out[2 * src], num * 2 * sizeof(float));
     }
 
+    if (whole < 0)
+        memset(&out[2 * num], 0, (wBurst.size() - num) * 2 * sizeof(float));
+    else
+        memset(out, 0, (wBurst.size() - num) * 2 * sizeof(float));
+
     return true;
 }
 
@@ -844,40 +996,96 @@ std::complex<float> interpolatePoint(const signalVector &inSig, float ix) {
     return pVal;
 }
 
-static std::complex<float> fastPeakDetect(const signalVector &rxBurst, float * index) {
-    float val, max = 0.0f;
-    std::complex<float> amp;
-    int _index = -1;
+static void initPeakTable() {
+    for (int p = 0; p <= PEAK_PHASES; p++) {
+        for (int k = 0; k < PEAK_TAPS; k++)
+            peakTable[p][k] = sinc(M_PI_F * (k - PEAK_TAPS / 2 - (float) p / PEAK_PHASES));
+    }
+}
 
-    for (int i = 0; i < rxBurst.size(); i++) {
-        //val = rxBurst[i].norm2();
-        val = std::norm(rxBurst[i]);
-        if (val > max) {
-            max = val;
-            _index = i;
-            amp = rxBurst[i];
-        }
+/* Table driven equivalent of interpolatePoint() */
+static std::complex<float> tablePoint(const signalVector &inSig, float ix) {
+    int whole = (int) floor(ix);
+    float pos = (ix - whole) * PEAK_PHASES;
+    int phase = std::min((int) pos, PEAK_PHASES - 1);
+    float blend = pos - phase;
+
+    int start = whole - PEAK_TAPS / 2;
+    if (start < 0) start = 0;
+    int end = whole + PEAK_TAPS / 2 + 1;
+    if ((unsigned) end > inSig.size() - 1) end = inSig.size() - 1;
+
+    const float * h0 = peakTable[phase];
+    const float * h1 = peakTable[phase + 1];
+
+    std::complex<float> pVal = std::complex<float>(0.0);
+    for (int i = start; i < end; i++) {
+        int k = i - whole + PEAK_TAPS / 2;
+        float h = h0[k] + blend * (h1[k] - h0[k]);
+
+        if (!inSig.isRealOnly())
+            pVal += inSig[i] * h;
+        else
+            pVal += inSig[i].real() * h;
     }
 
-    if (index)
-        *index = (float) _index;
+    return pVal;
+}
+
+/* Vertex offset of a parabola through samples at -1, 0 and 1 */
+static float parabolicPeak(float a, float b, float c) {
+    float denom = a - 2.0f * b + c;
 
-    return amp;
+    if (denom >= 0.0f)
+        return 0.0f;
+
+    return 0.5f * (a - c) / denom;
 }
 
-std::complex<float> peakDetect(const signalVector &rxBurst, float * peakIndex, float * avgPwr) {
-    std::complex<float> maxVal = 0.0;
-    float maxIndex = -1;
-    float sumPower = 0.0;
+/* Early minus late power, zero at the balance point used by peakDetect() */
+static float earlyLate(const signalVector &x, float ix) {
+    return std::norm(tablePoint(x, ix - 1.0f)) - std::norm(tablePoint(x, ix + 1.0f));
+}
 
-    for (unsigned int i = 0; i < rxBurst.size(); i++) {
-        //float samplePower = rxBurst[i].norm2();
-        float samplePower = std::norm(rxBurst[i]);
-        if (samplePower > maxVal.real()) {
-            maxVal = samplePower;
-            maxIndex = i;
+void setPeakEstimator(PeakEstimator est) {
+    peakEstimator = est;
+}
+
+/* Sub-sample peak location and value from the integer peak index */
+static std::complex<float> refinePeak(const signalVector &rxBurst, float maxIndex, float * peakIndex) {
+    std::complex<float> maxVal;
+
+    if (peakEstimator == PEAK_SECANT) {
+        // Parabolic fit on the integer samples around the peak gives the
+        // starting point. The early-late balance point is then solved with
+        // two secant steps on table interpolated points.
+        int i = (int) maxIndex;
+        if ((i > 0) && ((unsigned) i < rxBurst.size() - 1)) {
+            maxIndex += parabolicPeak(std::norm(rxBurst[i - 1]), std::norm(rxBurst[i]),
+                                      std::norm(rxBurst[i + 1]));
         }
-        sumPower += samplePower;
+
+        float x0 = maxIndex;
+        float g0 = earlyLate(rxBurst, x0);
+        float x1 = x0 + ((g0 < 0.0f) ? 0.125f : -0.125f);
+        float g1 = earlyLate(rxBurst, x1);
+
+        for (int n = 0; (n < 2) && (g1 != g0); n++) {
+            float x2 = std::clamp(x1 - g1 * (x1 - x0) / (g1 - g0), maxIndex - 1.0f, maxIndex + 1.0f);
+            x0 = x1;
+            g0 = g1;
+            x1 = x2;
+            if (n == 0)
+                g1 = earlyLate(rxBurst, x1);
+        }
+
+        maxIndex = x1;
+        maxVal = tablePoint(rxBurst, maxIndex);
+
+        if (peakIndex != nullptr)
+            *peakIndex = maxIndex;
+
+        return maxVal;
     }
 
     // interpolate around the peak
@@ -908,53 +1116,48 @@ std::complex<float> peakDetect(const signalVector &rxBurst, float * peakIndex, f
     if (peakIndex != nullptr)
         *peakIndex = maxIndex;
 
+    return maxVal;
+}
+
+std::complex<float> peakDetect(const signalVector &rxBurst, float * peakIndex, float * avgPwr) {
+    float maxPower = 0.0;
+    float maxIndex = -1;
+    float sumPower = 0.0;
+
+    for (unsigned int i = 0; i < rxBurst.size(); i++) {
+        float samplePower = std::norm(rxBurst[i]);
+        if (samplePower > maxPower) {
+            maxPower = samplePower;
+            maxIndex = i;
+        }
+        sumPower += samplePower;
+    }
+
+    std::complex<float> maxVal = refinePeak(rxBurst, maxIndex, peakIndex);
+
     if (avgPwr != nullptr)
         *avgPwr = (sumPower - std::norm(maxVal)) / (rxBurst.size() - 1);
 
     return maxVal;
-
 }
 
 void scaleVector(signalVector &x, std::complex<float> scale) {
-    signalVector::iterator xP = x.begin();
-    signalVector::iterator xPEnd = x.end();
-    if (!x.isRealOnly()) {
-        while (xP < xPEnd) {
-            *xP = *xP * scale;
-            xP++;
-        }
-    } else {
-        while (xP < xPEnd) {
-            *xP = xP->real() * scale;
-            xP++;
-        }
-    }
+    if (!x.isRealOnly())
+        vec_scale((float *) x.begin(), (float *) &scale, x.size());
+    else
+        vec_scale_real((float *) x.begin(), (float *) &scale, x.size());
 }
 
 /** in-place conjugation */
 void conjugateVector(signalVector &x) {
     if (x.isRealOnly()) return;
-    signalVector::iterator xP = x.begin();
-    signalVector::iterator xPEnd = x.end();
-    while (xP < xPEnd) {
-        //*xP = xP->conj();
-        *xP = std::conj(*xP);
-        xP++;
-    }
+    vec_conj((float *) x.begin(), x.size());
 }
 
 
 // in-place addition!!
-bool addVector(signalVector &x, signalVector &y) {
-    signalVector::iterator xP = x.begin();
-    signalVector::iterator yP = y.begin();
-    signalVector::iterator xPEnd = x.end();
-    signalVector::iterator yPEnd = y.end();
-    while ((xP < xPEnd) && (yP < yPEnd)) {
-        *xP = *xP + *yP;
-        xP++;
-        yP++;
-    }
+bool addVector(signalVector &x, const signalVector &y) {
+    vec_add((float *) x.begin(), (const float *) y.begin(), std::min(x.size(), y.size()));
     return true;
 }
 
@@ -993,6 +1196,64 @@ bool addVector(signalVector &x, signalVector &y) {
 //  }
 //}
 
+/*
+ * Pseudo-inverse (A^H A)^-1 A^H of the matrix A that maps the channel taps
+ * to the estimation window, A[i][k] being the rotated midamble symbol that
+ * tap k sees at sample i. Solved once per TSC by Gauss-Jordan elimination.
+ */
+static std::complex<float> * generateChannelEstimator(int tsc) {
+    typedef std::complex<double> cd;
+    cd a[CHAN_EST_LEN][CHAN_EST_TAPS];
+    cd m[CHAN_EST_TAPS][CHAN_EST_TAPS + CHAN_EST_LEN] = {};
+
+    for (int i = 0; i < CHAN_EST_LEN; i++) {
+        for (int k = 0; k < CHAN_EST_TAPS; k++) {
+            int n = MIDAMBLE_START + CHAN_EST_TAPS - 1 + i - k;
+            a[i][k] = (2.0 * (gTrainingSequence[tsc][n - MIDAMBLE_START] & 0x01) - 1.0) *
+                      std::polar(1.0, M_PI / 2.0 * (n % 4));
+        }
+    }
+
+    /* Augmented normal equations [A^H A | A^H] */
+    for (int r = 0; r < CHAN_EST_TAPS; r++) {
+        for (int i = 0; i < CHAN_EST_LEN; i++) {
+            for (int c = 0; c < CHAN_EST_TAPS; c++)
+                m[r][c] += std::conj(a[i][r]) * a[i][c];
+            m[r][CHAN_EST_TAPS + i] = std::conj(a[i][r]);
+        }
+    }
+
+    for (int c = 0; c < CHAN_EST_TAPS; c++) {
+        int pivot = c;
+        for (int r = c + 1; r < CHAN_EST_TAPS; r++) {
+            if (std::abs(m[r][c]) > std::abs(m[pivot][c]))
+                pivot = r;
+        }
+        if (std::abs(m[pivot][c]) < 1e-9)
+            return nullptr;
+        std::swap(m[c], m[pivot]);
+
+        cd inv = 1.0 / m[c][c];
+        for (auto &v : m[c])
+            v *= inv;
+        for (int r = 0; r < CHAN_EST_TAPS; r++) {
+            if (r == c)
+                continue;
+            cd f = m[r][c];
+            for (int j = 0; j < CHAN_EST_TAPS + CHAN_EST_LEN; j++)
+                m[r][j] -= f * m[c][j];
+        }
+    }
+
+    std::complex<float> * estimator = new std::complex<float>[CHAN_EST_TAPS * CHAN_EST_LEN];
+    for (int k = 0; k < CHAN_EST_TAPS; k++) {
+        for (int i = 0; i < CHAN_EST_LEN; i++)
+            estimator[k * CHAN_EST_LEN + i] = (std::complex<float>) m[k][CHAN_EST_TAPS + i];
+    }
+
+    return estimator;
+}
+
 bool generateMidamble(int sps, int tsc) {
     bool status = true;
     float toa;
@@ -1047,6 +1308,7 @@ bool generateMidamble(int sps, int tsc) {
     gMidambles[tsc]->buffer = data;
     gMidambles[tsc]->sequence = _midMidamble;
     gMidambles[tsc]->gain = peakDetect(*autocorr, &toa, nullptr);
+    gMidambles[tsc]->estimator = generateChannelEstimator(tsc);
 
     /* For 1 sps only
      *     (Half of correlation length - 1) + midpoint of pulse shape + remainder
@@ -1132,82 +1394,98 @@ bool generateRACHSequence(int sps) {
     return status;
 }
 
-static float computePeakRatio(signalVector * corr, int sps, float toa, std::complex<float> amp) {
-    int num = 0;
-    std::complex<float> * peak;
-    float rms, avg = 0.0;
-
-    peak = corr->begin() + (int) rint(toa);
-
-    /* Check for bogus results */
-    if ((toa < 0.0) || (toa > corr->size()))
-        return 0.0;
+/*
+ * Peak to side lobe ratio. The side lobes are averaged separately 2 to 5
+ * symbols before and after the peak and the quieter side is used, so a
+ * multipath echo on one side of the peak does not read as noise.
+ */
+static float computePeakRatio(const signalVector &corr, int sps, int peak, std::complex<float> amp) {
+    int num[2] = {0, 0};
+    float rms, pwr, avg[2] = {0.0, 0.0};
 
     for (int i = 2 * sps; i <= 5 * sps; i++) {
-        if (peak - i >= corr->begin()) {
-            //avg += (peak - i)->norm2();
-            avg += std::norm(*(peak + i));
-            num++;
+        if (peak - i >= 0) {
+            avg[0] += std::norm(corr[peak - i]);
+            num[0]++;
         }
-        if (peak + i < corr->end()) {
-            //avg += (peak + i)->norm2();
-            avg += std::norm(*(peak + i));
-            num++;
+        if (peak + i < (int) corr.size()) {
+            avg[1] += std::norm(corr[peak + i]);
+            num[1]++;
         }
     }
 
-    if (num < 2)
+    if (num[0] + num[1] < 2)
         return 0.0;
 
-    rms = sqrtf(avg / (float) num) + 0.00001;
+    if (num[0] && num[1])
+        pwr = std::min(avg[0] / (float) num[0], avg[1] / (float) num[1]);
+    else
+        pwr = (avg[0] + avg[1]) / (float) (num[0] + num[1]);
+
+    rms = sqrtf(pwr) + 0.00001;
 
-    //return (amp.abs()) / rms;
     return std::abs(amp) / rms;
 }
 
 bool energyDetect(signalVector &rxBurst, unsigned windowLength, float detectThreshold, float * avgPwr) {
-    signalVector::const_iterator windowItr = rxBurst.begin(); //+rxBurst.size()/2 - 5*windowLength/2;
-    float energy = 0.0;
+    float pwr;
     if (windowLength < 0) windowLength = 20;
     if (windowLength > rxBurst.size()) windowLength = rxBurst.size();
-    for (unsigned i = 0; i < windowLength; i++) {
-        //energy += windowItr->norm2();
-        energy += std::norm(*windowItr);
-        windowItr += 4;
-    }
-    if (avgPwr) *avgPwr = energy / windowLength;
-    return (energy / windowLength > detectThreshold * detectThreshold);
+
+    /* Every 4th sample, without reading past the end of the burst */
+    size_t num = std::min<size_t>(windowLength, (rxBurst.size() + 3) / 4);
+    pwr = num ? vec_norm2_strided((const float *) rxBurst.begin(), num, 4) / num : 0.0f;
+    if (avgPwr) *avgPwr = pwr;
+    return (pwr > detectThreshold * detectThreshold);
+}
+
+/* Per-thread correlation output of the burst detectors, grown as needed */
+static std::complex<float> * correlationScratch(size_t len) {
+    static thread_local signalVector scratch;
+    if (scratch.size() < len)
+        scratch.resize(len);
+
+    return scratch.begin();
 }
 
 /*
- * Detect a burst based on correlation and peak-to-average ratio
- *
- * For one sampler-per-symbol, perform fast peak detection (no interpolation)
- * for initial gating. We do this because energy detection should be disabled.
- * For higher oversampling values, we assume the energy detector is in place
- * and we run full interpolating peak detection.
+ * The burst itself when its guard space covers the correlation span, or a
+ * padded copy that the caller deletes. Tail is the padding read past the end.
  */
-static int detectBurst(signalVector &burst, signalVector &corr, CorrelationSequence * sync, float thresh,
-                       int sps, std::complex<float> * amp, float * toa, int start, int len) {
-    /* Correlate */
-    if (!convolve(&burst, sync->sequence, &corr, CUSTOM, start, len, sps, 0)) {
-        return -SIGERR_INTERNAL;
-    }
+static const signalVector * guardBurst(const signalVector &burst, int h_len, int start, int len, int &tail) {
+    int head = std::max(h_len - 1 - start, 0);
+    tail = std::max(start + len - (int) burst.size(), 0);
 
-    /* Peak detection - place restrictions at correlation edges */
-    *amp = fastPeakDetect(corr, toa);
+    if ((burst.headroom() >= (size_t) head) && (burst.tailroom() >= (size_t) tail))
+        return &burst;
+
+    signalVector * padded = new signalVector(burst.size(), head, tail);
+    burst.copyTo(*padded);
+
+    return padded;
+}
 
-    if ((*toa < 3 * sps) || (*toa > len - 3 * sps)) {
+/*
+ * Qualify the integer correlation peak by position and peak-to-average
+ * ratio, then interpolate it and normalise by the sequence gain
+ */
+static int qualifyPeak(const signalVector &corr, const CorrelationSequence * sync, float thresh, int sps, int peak,
+                       std::complex<float> * amp, float * toa, float * ratio = nullptr) {
+    /* Peak detection - place restrictions at correlation edges */
+    if ((peak < 3 * sps) || (peak > (int) corr.size() - 3 * sps)) {
         return 0;
     }
 
     /* Peak -to-average ratio */
-    if (computePeakRatio(&corr, sps, *toa, *amp) < thresh) {
+    float par = computePeakRatio(corr, sps, peak, corr[peak]);
+    if (ratio)
+        *ratio = par;
+    if (par < thresh) {
         return 0;
     }
 
-    /* Compute peak-to-average ratio. Reject if we don't have enough values */
-    *amp = peakDetect(corr, toa, nullptr);
+    /* Interpolate the peak */
+    *amp = refinePeak(corr, peak, toa);
 
     /* Normalize our channel gain */
     *amp = *amp / sync->gain;
@@ -1223,15 +1501,35 @@ static int detectBurst(signalVector &burst, signalVector &corr, CorrelationSeque
     return 1;
 }
 
-static int detectClipping(signalVector &burst, float thresh) {
-    for (size_t i = 0; i < burst.size(); i++) {
-        if (fabs(burst[i].real()) > thresh)
-            return 1;
-        if (fabs(burst[i].imag()) > thresh)
-            return 1;
+/*
+ * Detect a burst based on correlation and peak-to-average ratio
+ *
+ * One fused pass checks the burst for clipping, when a clipping threshold
+ * is given, and correlates into per-thread scratch while tracking the
+ * integer peak. The side lobes and the interpolated peak are then read
+ * from the scratch, which is only the search window long.
+ */
+static int detectBurst(signalVector &burst, CorrelationSequence * sync, float thresh, int sps,
+                       std::complex<float> * amp, float * toa, int start, int len, float clip = 0.0f) {
+    signalVector corr(correlationScratch(len), 0, len);
+
+    int tail;
+    const signalVector * x = guardBurst(burst, sync->sequence->size(), start, len, tail);
+
+    float power;
+    int peak = convolve_detect((const float *) x->begin(), x->size() + tail, clip,
+                               (const float *) sync->sequence->begin(), sync->sequence->size(),
+                               (float *) corr.begin(), start, len, sps, &power);
+    if (x != &burst)
+        delete x;
+
+    if (peak == -2) {
+        return -SIGERR_CLIP;
+    } else if (peak < 0) {
+        return -SIGERR_INTERNAL;
     }
 
-    return 0;
+    return qualifyPeak(corr, sync, thresh, sps, peak, amp, toa);
 }
 
 /* 
@@ -1246,17 +1544,12 @@ int detectRACHBurst(signalVector &rxBurst, float thresh, int sps, std::complex<f
     int rc, start, target, head, tail, len;
     float _toa;
     std::complex<float> _amp;
-    signalVector corr;
     CorrelationSequence * sync;
 
     if ((sps != 1) && (sps != 4)) {
         return -SIGERR_UNSUPPORTED;
     }
 
-    if (detectClipping(rxBurst, CLIP_THRESH)) {
-        return -SIGERR_CLIP;
-    }
-
     target = 8 + 40;
     head = 4;
     tail = 10;
@@ -1264,10 +1557,11 @@ int detectRACHBurst(signalVector &rxBurst, float thresh, int sps, std::complex<f
     start = (target - head) * sps - 1;
     len = (head + tail) * sps;
     sync = gRACHSequence;
-    corr = signalVector(len);
 
-    rc = detectBurst(rxBurst, corr, sync, thresh, sps, &_amp, &_toa, start, len);
-    if (rc < 0) {
+    rc = detectBurst(rxBurst, sync, thresh, sps, &_amp, &_toa, start, len, CLIP_THRESH);
+    if (rc == -SIGERR_CLIP) {
+        return rc;
+    } else if (rc < 0) {
         return -1;
     } else if (!rc) {
         if (amp)
@@ -1286,6 +1580,46 @@ int detectRACHBurst(signalVector &rxBurst, float thresh, int sps, std::complex<f
     return 1;
 }
 
+/* Keep a filter of the given length, allocating only when the length changes */
+static signalVector * reuseFilter(signalVector * filter, size_t len) {
+    if (filter && (filter->size() == len))
+        return filter;
+
+    delete filter;
+    return new signalVector(len);
+}
+
+/*
+ * Channel estimate from the midamble samples around the detected burst. The
+ * samples are taken on the whole sample grid nearest the TOA, the remainder
+ * is reported in the offset, so only the estimator product is computed.
+ * The estimate overwrites chan, which is only allocated on first use.
+ */
+static signalVector * estimateChannel(const signalVector &burst, const CorrelationSequence * sync, int sps,
+                                      float toa, signalVector * chan, float * offset) {
+    int whole = (int) lrintf(toa);
+    int first = (MIDAMBLE_START + CHAN_EST_TAPS - 1 - CHAN_EST_LEAD) * sps + whole;
+
+    chan = reuseFilter(chan, CHAN_EST_TAPS * sps);
+    std::fill(chan->begin(), chan->end(), std::complex<float>(0.0f));
+
+    *offset = CHAN_EST_LEAD * sps + toa - whole;
+
+    if (!sync->estimator || (first < 0) || (first + (CHAN_EST_LEN - 1) * sps >= (int) burst.size()))
+        return chan;
+
+    const std::complex<float> * x = burst.begin() + first;
+    for (int k = 0; k < CHAN_EST_TAPS; k++) {
+        const std::complex<float> * e = &sync->estimator[k * CHAN_EST_LEN];
+        std::complex<float> h = 0.0f;
+        for (int i = 0; i < CHAN_EST_LEN; i++)
+            h += e[i] * x[i * sps];
+        (*chan)[k * sps] = h;
+    }
+
+    return chan;
+}
+
 /* 
  * Normal burst detection
  *
@@ -1299,7 +1633,6 @@ int analyzeTrafficBurst(signalVector &rxBurst, unsigned tsc, float thresh, int s
     int rc, start, target, head, tail, len;
     std::complex<float> _amp;
     float _toa;
-    signalVector corr;
     CorrelationSequence * sync;
 
     if ((tsc < 0) || (tsc > 7) || ((sps != 1) && (sps != 4))) {
@@ -1313,9 +1646,8 @@ int analyzeTrafficBurst(signalVector &rxBurst, unsigned tsc, float thresh, int s
     start = (target - head) * sps - 1;
     len = (head + tail) * sps;
     sync = gMidambles[tsc];
-    corr = signalVector(len);
 
-    rc = detectBurst(rxBurst, corr, sync, thresh, sps, &_amp, &_toa, start, len);
+    rc = detectBurst(rxBurst, sync, thresh, sps, &_amp, &_toa, start, len);
     if (rc < 0) {
         return -SIGERR_INTERNAL;
     } else if (!rc) {
@@ -1333,18 +1665,87 @@ int analyzeTrafficBurst(signalVector &rxBurst, unsigned tsc, float thresh, int s
     if (amp)
         *amp = _amp;
 
-    /* Equalization not currently supported */
     if (chan_req) {
-        *chan = new signalVector(6 * sps);
+        float offset;
+        *chan = estimateChannel(rxBurst, sync, sps, _toa, *chan, &offset);
 
         if (chan_offset) {
-            *chan_offset = 0.0;
+            *chan_offset = offset;
         }
     }
 
     return 1;
 }
 
+/*
+ * Blind normal burst detection
+ *
+ * Same correlation window as analyzeTrafficBurst(), with every generated
+ * midamble correlated in one batched pass over the window.
+ */
+int analyzeTrafficBurstTSCs(signalVector &rxBurst, float thresh, int sps, std::complex<float> * amp, float * toa,
+                            float * ratio, unsigned max_toa) {
+    int start, target, head, tail, len, num = 0, mask = 0;
+    int tscs[8], index[8];
+    const float * seqs[8];
+    float power[8];
+
+    if ((sps != 1) && (sps != 4)) {
+        return -SIGERR_UNSUPPORTED;
+    }
+
+    for (int tsc = 0; tsc < 8; tsc++) {
+        amp[tsc] = 0.0f;
+        toa[tsc] = 0.0f;
+        ratio[tsc] = 0.0f;
+
+        if (!gMidambles[tsc])
+            continue;
+        if (num && (gMidambles[tsc]->sequence->size() != gMidambles[tscs[0]]->sequence->size()))
+            return -SIGERR_INTERNAL;
+
+        tscs[num] = tsc;
+        seqs[num++] = (const float *) gMidambles[tsc]->sequence->begin();
+    }
+
+    if (!num)
+        return 0;
+
+    target = 3 + 58 + 16 + 5;
+    head = 4;
+    tail = 4 + max_toa;
+
+    start = (target - head) * sps - 1;
+    len = (head + tail) * sps;
+
+    std::complex<float> * corr = correlationScratch(num * len);
+    int h_len = gMidambles[tscs[0]]->sequence->size();
+    int pad;
+    const signalVector * x = guardBurst(rxBurst, h_len, start, len, pad);
+
+    int rc = convolve_detect_multi((const float *) x->begin(), x->size() + pad, seqs, num, h_len,
+                                   (float *) corr, start, len, sps, index, power);
+    if (x != &rxBurst)
+        delete x;
+
+    if (rc < 0) {
+        return -SIGERR_INTERNAL;
+    }
+
+    for (int n = 0; n < num; n++) {
+        int tsc = tscs[n];
+        signalVector seqCorr(corr, n * len, len);
+
+        if (qualifyPeak(seqCorr, gMidambles[tsc], thresh, sps, index[n], &amp[tsc], &toa[tsc], &ratio[tsc])) {
+            /* Subtract forward search bits from delay */
+            toa[tsc] -= head * sps;
+            mask |= 1 << tsc;
+        }
+    }
+
+    return mask;
+}
+
 signalVector * decimateVector(signalVector &wVector, int decimationFactor) {
     if (decimationFactor <= 1) {
         return nullptr;
@@ -1353,148 +1754,156 @@ signalVector * decimateVector(signalVector &wVector, int decimationFactor) {
     signalVector * decVector = new signalVector(wVector.size() / decimationFactor);
     decVector->isRealOnly(wVector.isRealOnly());
 
-    signalVector::iterator vecItr = decVector->begin();
-    for (unsigned int i = 0; i < wVector.size(); i += decimationFactor)
-        *vecItr++ = wVector[i];
+    vec_decimate((float *) decVector->begin(), (float *) wVector.begin(), decVector->size(), decimationFactor);
 
     return decVector;
 }
 
 
 SoftVector * demodulateBurst(signalVector &rxBurst, int sps, std::complex<float> channel, float TOA) {
-    scaleVector(rxBurst, ((std::complex<float>) 1.0) / channel);
-    delayVector(rxBurst, -TOA);
+    SoftVector * burstBits = new SoftVector(rxBurst.size() / sps);
 
-    signalVector * shapedBurst = &rxBurst;
+    demodulateBurst(rxBurst, sps, channel, TOA, *burstBits);
 
-    // shift up by a quarter of a frequency
-    // ignore starting phase, since spec allows for discontinuous phase
-    GMSKReverseRotate(*shapedBurst, sps);
+    return burstBits;
+}
 
-    // run through slicer
+void demodulateBurst(signalVector &rxBurst, int sps, std::complex<float> channel, float TOA, SoftVector &bits) {
+    delayVector(rxBurst, -TOA);
+
+    // Decimate first and in place, the reverse rotation at symbol spacing is
+    // the single sample-per-symbol rotation table
+    signalVector shapedBurst(rxBurst.begin(), 0, rxBurst.size() / sps);
     if (sps > 1) {
-        signalVector * decShapedBurst = decimateVector(*shapedBurst, sps);
-        shapedBurst = decShapedBurst;
+        vec_decimate((float *) shapedBurst.begin(), (float *) rxBurst.begin(), shapedBurst.size(), sps);
     }
 
-    vectorSlicer(shapedBurst);
+    // shift up by a quarter of a frequency and apply the channel gain
+    // ignore starting phase, since spec allows for discontinuous phase
+    GMSKReverseRotate(shapedBurst, 1, ((std::complex<float>) 1.0) / channel);
 
-    SoftVector * burstBits = new SoftVector(shapedBurst->size());
+    vectorSlicer(&shapedBurst);
 
-    SoftVector::iterator burstItr = burstBits->begin();
-    signalVector::iterator shapedItr = shapedBurst->begin();
-    for (; shapedItr < shapedBurst->end(); shapedItr++) {
-        *burstItr++ = shapedItr->real();
+    size_t len = std::min(bits.size(), shapedBurst.size());
+    for (size_t i = 0; i < len; i++) {
+        bits[i] = shapedBurst[i].real();
     }
+}
 
-    if (sps > 1) {
-        delete shapedBurst;
-    }
+/*
+ * Single pass demodulator. The fractional delay is interpolated only at the
+ * symbol instants and each symbol is derotated, scaled and sliced straight
+ * to a soft bit, so the burst is read once and nothing is written back.
+ * Symbols shifted in from outside the burst are zero, as with delayVector().
+ */
+void demodulateBurst(const signalVector &rxBurst, int sps, std::complex<float> channel, float TOA,
+                     unsigned char * bits, size_t len) {
+    int whole, phase;
+    delayPhase(-TOA, whole, phase);
+
+    const signalVector * h = phase ? gDelayFilters->filters[phase] : nullptr;
+    size_t before = h ? DELAY_FILT_LEN - 1 - DELAY_FILT_LEN / 2 : 0;
+    size_t after = h ? DELAY_FILT_LEN / 2 : 0;
+
+    /* Filter windows reach into the guards, pad bursts allocated without them */
+    if ((rxBurst.headroom() < before) || (rxBurst.tailroom() < after)) {
+        signalVector padded(rxBurst.size(), before, after);
+        rxBurst.copyTo(padded);
+        demodulateBurst(padded, sps, channel, TOA, bits, len);
+        return;
+    }
+
+    /* Symbol k is taken from sample k * sps - whole when that is inside the burst */
+    int size = rxBurst.size();
+    int num = std::min<int>(std::min<int>(len, size / sps), GMSKReverseRotation1->size());
+    int first = std::clamp(whole > 0 ? (whole + sps - 1) / sps : 0, 0, num);
+    int last = std::clamp(size + whole > 0 ? (size + whole + sps - 1) / sps : 0, first, num);
+
+    std::complex<float> scale = ((std::complex<float>) 1.0) / channel;
+    const float * x = (const float *) (rxBurst.begin() + first * sps - whole) - 2 * before;
+
+    convolve_soft_bits(x, sps, h ? (const float *) h->begin() : nullptr, DELAY_FILT_LEN,
+                       (const float *) (GMSKReverseRotation1->begin() + first), (const float *) &scale,
+                       bits + first, last - first);
+
+    /* A zero sample slices to the middle of the soft bit range */
+    std::fill(bits, bits + first, 128);
+    std::fill(bits + last, bits + len, 128);
+}
 
-    return burstBits;
+/*
+ * Working storage of the DFE design, sized for the longest feedforward
+ * filter. The second lattice vector is twice that length so its one sample
+ * advance on every stage is a pointer increment over trailing zeros.
+ */
+#define DFE_MAX_TAPS 16
 
-}
+struct DFEWorkspace {
+    std::complex<float> g0[DFE_MAX_TAPS];
+    std::complex<float> g1[2 * DFE_MAX_TAPS];
+    std::complex<float> l[DFE_MAX_TAPS][DFE_MAX_TAPS];
+    std::complex<float> v[DFE_MAX_TAPS];
+};
 
 // Assumes symbol-spaced sampling!!!
 // Based upon paper by Al-Dhahir and Cioffi
 bool designDFE(signalVector &channelResponse, float SNRestimate, int Nf, signalVector ** feedForwardFilter,
                signalVector ** feedbackFilter) {
-
-    signalVector G0(Nf);
-    signalVector G1(Nf);
-    signalVector::iterator G0ptr = G0.begin();
-    signalVector::iterator G1ptr = G1.begin();
-    signalVector::iterator chanPtr = channelResponse.begin();
+    static thread_local DFEWorkspace ws;
 
     int nu = channelResponse.size() - 1;
+    if ((Nf > DFE_MAX_TAPS) || (nu < 0) || (nu >= Nf))
+        return false;
 
-    *G0ptr = 1.0 / sqrtf(SNRestimate);
-    for (int j = 0; j <= nu; j++) {
-        //*G1ptr = chanPtr->conj();
-        *G1ptr = std::conj(*chanPtr);
-        G1ptr++;
-        chanPtr++;
-    }
+    const std::complex<float> * chan = channelResponse.begin();
+    std::complex<float> * g0 = ws.g0;
+    std::complex<float> * g1 = ws.g1;
 
-    signalVector * L[Nf];
-    signalVector::iterator Lptr;
-    float d;
+    std::fill(g0, g0 + Nf, 0.0f);
+    std::fill(g1, g1 + 2 * Nf, 0.0f);
+    g0[0] = 1.0f / sqrtf(SNRestimate);
+    for (int j = 0; j <= nu; j++)
+        g1[j] = std::conj(chan[j]);
+
+    /* Cholesky factor rows by lattice recursion, row i starting at column i */
+    float d = 0.0f;
     for (int i = 0; i < Nf; i++) {
-        //d = G0.begin()->norm2() + G1.begin()->norm2();
-        d = std::norm(*(G0.begin())) + std::norm(*(G1.begin()));
-        L[i] = new signalVector(Nf + nu);
-        Lptr = L[i]->begin() + i;
-        G0ptr = G0.begin();
-        G1ptr = G1.begin();
-        while ((G0ptr < G0.end()) && (Lptr < L[i]->end())) {
-            //*Lptr = (*G0ptr * (G0.begin()->conj()) + *G1ptr * (G1.begin()->conj())) / d;
-            *Lptr = (*G0ptr * (std::conj(*(G0.begin()))) + *G1ptr * (std::conj(*(G1.begin())))) / d;
-            Lptr++;
-            G0ptr++;
-            G1ptr++;
-        }
-        std::complex<float> k = (*G1.begin()) / (*G0.begin());
+        d = std::norm(g0[0]) + std::norm(g1[0]);
+        std::complex<float> a = std::conj(g0[0]) / d;
+        std::complex<float> b = std::conj(g1[0]) / d;
+        vec_lincomb((float *) ws.l[i], (float *) g0, (float *) &a, (float *) g1, (float *) &b, Nf);
 
         if (i != Nf - 1) {
-            signalVector G0new = G1;
-            //scaleVector(G0new, k.conj());
-            scaleVector(G0new, std::conj(k));
-            addVector(G0new, G0);
-
-            signalVector G1new = G0;
-            scaleVector(G1new, k * std::complex<float>(-1.0));
-            addVector(G1new, G1);
-            delayVector(G1new, -1.0);
-
-            //scaleVector(G0new, 1.0 / sqrtf(1.0 + k.norm2()));
-            //scaleVector(G1new, 1.0 / sqrtf(1.0 + k.norm2()));
-            scaleVector(G0new, 1.0 / sqrtf(1.0 + std::norm(k)));
-            scaleVector(G1new, 1.0 / sqrtf(1.0 + std::norm(k)));
-            G0 = G0new;
-            G1 = G1new;
+            std::complex<float> k = g1[0] / g0[0];
+            vec_lattice((float *) g0, (float *) g1, (float *) &k, 1.0f / sqrtf(1.0f + std::norm(k)), Nf);
+            g1++;
         }
     }
 
-    *feedbackFilter = new signalVector(nu);
-    L[Nf - 1]->segmentCopyTo(**feedbackFilter, Nf, nu);
-    scaleVector(**feedbackFilter, (std::complex<float>) -1.0);
-    conjugateVector(**feedbackFilter);
+    *feedbackFilter = reuseFilter(*feedbackFilter, nu);
+    for (int j = 0; j < nu; j++)
+        (**feedbackFilter)[j] = -std::conj(ws.l[Nf - 1][j + 1]);
 
-    signalVector v(Nf);
-    signalVector::iterator vStart = v.begin();
-    signalVector::iterator vPtr;
-    *(vStart + Nf - 1) = (std::complex<float>) 1.0;
+    std::complex<float> * v = ws.v;
+    v[Nf - 1] = 1.0f;
     for (int k = Nf - 2; k >= 0; k--) {
-        Lptr = L[k]->begin() + k + 1;
-        vPtr = vStart + k + 1;
-        std::complex<float> v_k = 0.0;
-        for (int j = k + 1; j < Nf; j++) {
-            v_k -= (*vPtr) * (*Lptr);
-            vPtr++;
-            Lptr++;
-        }
-        *(vStart + k) = v_k;
+        std::complex<float> v_k = 0.0f;
+        for (int j = k + 1; j < Nf; j++)
+            v_k -= v[j] * ws.l[k][j - k];
+        v[k] = v_k;
     }
 
-    *feedForwardFilter = new signalVector(Nf);
-    signalVector::iterator w = (*feedForwardFilter)->end();
+    *feedForwardFilter = reuseFilter(*feedForwardFilter, Nf);
+    std::complex<float> * w = (*feedForwardFilter)->end();
     for (int i = 0; i < Nf; i++) {
-        delete L[i];
-        std::complex<float> w_i = 0.0;
-        int endPt = (nu < (Nf - 1 - i)) ? nu : (Nf - 1 - i);
-        vPtr = vStart + i;
-        chanPtr = channelResponse.begin();
-        for (int k = 0; k < endPt + 1; k++) {
-            //w_i += (*vPtr) * (chanPtr->conj());
-            w_i += (*vPtr) * std::conj(*chanPtr);
-            vPtr++;
-            chanPtr++;
-        }
+        std::complex<float> w_i = 0.0f;
+        int endPt = std::min(nu, Nf - 1 - i);
+        for (int k = 0; k <= endPt; k++)
+            w_i += v[i + k] * std::conj(chan[k]);
         *--w = w_i / d;
     }
 
     return true;
-
 }
 
 // Assumes symbol-rate sampling!!!!
@@ -1518,8 +1927,8 @@ SoftVector * equalizeBurst(signalVector &rxBurst, float TOA, int sps, signalVect
 
     signalVector::iterator dPtr = postForward->begin();
     signalVector::iterator dBackPtr;
-    signalVector::iterator rotPtr = GMSKRotationN->begin();
-    signalVector::iterator revRotPtr = GMSKReverseRotationN->begin();
+    signalVector::iterator rotPtr = ((sps == 1) ? GMSKRotation1 : GMSKRotationN)->begin();
+    signalVector::iterator revRotPtr = ((sps == 1) ? GMSKReverseRotation1 : GMSKReverseRotationN)->begin();
 
     signalVector * DFEoutput = new signalVector(postForward->size());
     signalVector::iterator DFEItr = DFEoutput->begin();
@@ -1559,14 +1968,175 @@ SoftVector * equalizeBurst(signalVector &rxBurst, float TOA, int sps, signalVect
     return burstBits;
 }
 
+/*
+ * Same equalizer as above. Only the steady state part of the feed forward
+ * output is computed, into per-thread scratch space, and every symbol is
+ * sliced to its wire format soft bit as soon as it is decided.
+ */
+bool equalizeBurst(signalVector &rxBurst, float TOA, int sps, signalVector &w, signalVector &b,
+                   unsigned char * bits, size_t len) {
+    static thread_local signalVector scratch;
+
+    if (!delayVector(rxBurst, -TOA)) {
+        return false;
+    }
+
+    size_t size = rxBurst.size();
+    if (scratch.size() < size)
+        scratch.resize(size);
+
+    if (!convolve(&rxBurst, &w, &scratch, CUSTOM, w.size() - 1, size)) {
+        return false;
+    }
+
+    signalVector::iterator postForward = scratch.begin();
+    signalVector::iterator rotPtr = ((sps == 1) ? GMSKRotation1 : GMSKRotationN)->begin();
+    signalVector::iterator revRotPtr = ((sps == 1) ? GMSKReverseRotation1 : GMSKReverseRotationN)->begin();
+
+    for (size_t i = 0; i < size; i++) {
+        std::complex<float> d = postForward[i];
+        for (size_t k = 0; (k < b.size()) && (k < i); k++) {
+            d = d + b[k] * postForward[i - 1 - k];
+        }
+        d = d * revRotPtr[i];
+
+        if (i < len) {
+            float soft = (float) (0.5 * (d.real() + 1.0F));
+            soft = std::clamp(soft, 0.0f, 1.0f);
+            bits[i] = (unsigned char) round(soft * 255.0);
+        }
+
+        // make decision on symbol
+        postForward[i] = ((d.real() > 0.0) ? 1.0f : -1.0f) * rotPtr[i];
+    }
+
+    return true;
+}
+
+/*
+ * Survivor storage of the sequence estimator. All of it is sized for the
+ * longest burst and the largest trellis and kept per thread, so demodulation
+ * workers reuse the same block for every burst and nothing is allocated.
+ */
+#define MLSE_MAX_SYMBOLS 157
+
+struct MLSESurvivors {
+    std::complex<float> y[MLSE_MAX_SYMBOLS];                 ///< derotated symbol spaced samples, then residuals
+    unsigned decisions[MLSE_MAX_SYMBOLS];                    ///< add-compare-select decisions of each step
+    float metrics[TRELLIS_MAX_STATES];                       ///< path metrics
+    float pred[4 * TRELLIS_MAX_STATES];                      ///< planar expected output of every hypothesis
+    float symbols[TRELLIS_MAX_MEMORY + MLSE_MAX_SYMBOLS];    ///< traced back symbols, preceded by the initial state
+};
+
+bool equalizeBurstMLSE(signalVector &rxBurst, float TOA, int sps, const signalVector &channel,
+                       unsigned char * bits, size_t len) {
+    static thread_local MLSESurvivors sv;
+    std::complex<float> g[TRELLIS_MAX_MEMORY + 1];
+    int taps, start = 0;
+    float best = -1.0f, energy = 0.0f;
+
+    /* Symbol spaced taps, keep the strongest window that fits the trellis */
+    int num_taps = channel.size() / sps;
+    int window = std::min(num_taps, TRELLIS_MAX_MEMORY + 1);
+    for (int i = 0; i + window <= num_taps; i++) {
+        float e = 0.0f;
+        for (int k = 0; k < window; k++)
+            e += std::norm(channel[(i + k) * sps]);
+        if (e > best) {
+            best = e;
+            start = i;
+        }
+    }
+
+    /*
+     * Fold the reverse GMSK rotation into the channel, a burst derotated at
+     * the symbol instants is then the channel applied to real symbols.
+     */
+    for (taps = 0; taps < window; taps++) {
+        g[taps] = channel[(start + taps) * sps] * (*GMSKReverseRotation1)[taps];
+        energy += std::norm(g[taps]);
+    }
+    /* Without channel memory the trellis has a single state and no decisions to trace */
+    if ((taps < 2) || (energy <= 0.0f))
+        return false;
+
+    /* Line the strongest tap up with the symbol it belongs to */
+    if (!delayVector(rxBurst, -(TOA + start * sps)))
+        return false;
+
+    int memory = taps - 1;
+    int num_states = 1 << memory;
+    int num = std::min<int>(std::min<int>(len, rxBurst.size() / sps), MLSE_MAX_SYMBOLS);
+
+    for (int n = 0; n < num; n++)
+        sv.y[n] = rxBurst[n * sps] * (*GMSKReverseRotation1)[n];
+
+    for (int h = 0; h < 2 * num_states; h++) {
+        std::complex<float> v = 0.0f;
+        for (int k = 0; k < taps; k++)
+            v += (h & (1 << k)) ? -g[k] : g[k];
+        sv.pred[h] = v.real();
+        sv.pred[2 * num_states + h] = v.imag();
+    }
+
+    /* Viterbi over the burst, symbols before the burst are unknown */
+    std::fill(sv.metrics, sv.metrics + num_states, 0.0f);
+    trellis_forward(sv.pred, (const float *) sv.y, num, sv.metrics, sv.decisions, num_states);
+
+    int state = std::min_element(sv.metrics, sv.metrics + num_states) - sv.metrics;
+    for (int n = num - 1; n >= 0; n--) {
+        sv.symbols[memory + n] = (state & 1) ? -1.0f : 1.0f;
+        state = (state >> 1) | (((sv.decisions[n] >> state) & 1) ? num_states >> 1 : 0);
+    }
+    for (int k = 0; k < memory; k++)
+        sv.symbols[memory - 1 - k] = (state & (1 << k)) ? -1.0f : 1.0f;
+
+    /*
+     * Soft output from the growth of the squared error over the taps a
+     * symbol reaches when it alone is flipped, relative to the growth over
+     * a noiseless channel. Flipping symbol n adds 2 * d[n] * g[k] to the
+     * residual at n + k, so the growth is linear in the residual. Clean
+     * symbols slice to 0 or 1 as with demodulateBurst() and ambiguous ones
+     * tend to the middle.
+     */
+    const float * d = sv.symbols + memory;
+    for (int n = 0; n < num; n++) {
+        std::complex<float> v = 0.0f;
+        for (int j = 0; j < taps; j++)
+            v += g[j] * d[n - j];
+        sv.y[n] -= v;
+    }
+
+    for (int n = 0; n < num; n++) {
+        float corr = 0.0f, ref = 0.0f;
+        for (int k = 0; k < taps && n + k < num; k++) {
+            corr += sv.y[n + k].real() * g[k].real() + sv.y[n + k].imag() * g[k].imag();
+            ref += std::norm(g[k]);
+        }
+        float soft = 0.5f * (1.0f + d[n] * std::clamp(1.0f + d[n] * corr / ref, 0.0f, 1.0f));
+        bits[n] = (unsigned char) (soft * 255.0f + 0.5f);
+    }
+
+    std::fill(bits + num, bits + len, 128);
+
+    return true;
+}
+
 bool sigProcLibSetup(int sps) {
     if ((sps != 1) && (sps != 4)) {
         return false;
     }
 
+    SPDLOG_INFO("Using {} convolution kernels", convolve_init());
+    SPDLOG_INFO("Using {} vector kernels", vec_init());
+    SPDLOG_INFO("Using {} trellis kernels", trellis_init());
+
     initTrigTables();
+    initPeakTable();
     initGMSKRotationTables(sps);
 
+    gDelayFilters = generateDelayFilters();
+
     GSMPulse1 = generateGSMPulse(1, 2);
     if (sps > 1) {
         GSMPulse = generateGSMPulse(sps, 2);
@@ -1577,5 +2147,13 @@ bool sigProcLibSetup(int sps) {
         return false;
     }
 
+    /* Receive runs at 1 sps, every TSC is ready for blind detection */
+    for (int tsc = 0; tsc < 8; tsc++) {
+        if (!generateMidamble(1, tsc)) {
+            sigProcLibDestroy();
+            return false;
+        }
+    }
+
     return true;
 }
@@ -24,6 +24,13 @@ enum ConvType {
     UNDEFINED,
 };
 
+/**
+    Zeroed guard length to allocate on each side of received bursts, see
+    signalVector(size, start, tail). Covers the longest pulse shaping filter
+    and the fractional delay filter so convolve() can filter bursts in place.
+*/
+#define SIGNAL_GUARD_LEN 16
+
 enum signalError {
     SIGERR_NONE,
     SIGERR_BOUNDS,
@@ -53,8 +60,10 @@ public:
         m_symmetry = wVector.getSymmetry();
     };
 
-    signalVector(size_t size, size_t start) : Vector<std::complex<float>>(size + start) {
+    /** Allocate with zeroed guard space before and after the data, see headroom() and tailroom() */
+    signalVector(size_t size, size_t start, size_t tail = 0) : Vector<std::complex<float>>(start + size + tail) {
         mStart = mData + start;
+        mEnd = mStart + size;
         m_symmetry = NONE;
     };
 
@@ -140,14 +149,34 @@ bool vectorSlicer(signalVector * x);
 /** GMSK modulate a GSM burst of bits */
 signalVector * modulateBurst(const BitVector &wBurst, int guardPeriodLength, int sps, bool emptyPulse = false);
 
+/**
+	GMSK modulate a GSM burst of bits into a preallocated vector.
+	@param wBurst The burst bits, not differentially encoded.
+	@param sps The number of samples per GSM symbol.
+	@param out The output, sps * (bits + guard period) samples long. At 4 sps the
+	           guard period must be at least 4 symbols.
+	@param scale Gain applied to the modulated samples.
+*/
+void modulateBurst(const BitVector &wBurst, int sps, signalVector &out, std::complex<float> scale = 1.0f);
+
+/**
+	GMSK modulate a GSM burst of bits straight to interleaved 16-bit device samples.
+	@param wBurst The burst bits, not differentially encoded.
+	@param sps The number of samples per GSM symbol.
+	@param out The output, 2 * len shorts, with the same guard period requirement.
+	@param len The burst length in complex samples.
+	@param scale Gain applied before saturating to the 16-bit range.
+*/
+void modulateBurst(const BitVector &wBurst, int sps, short * out, size_t len, float scale);
+
 /** Sinc function */
 float sinc(float x);
 
-/** Delay a vector */
-bool delayVector(signalVector &wBurst, float delay);
+/** Delay a vector, optionally applying a complex scale in the same pass */
+bool delayVector(signalVector &wBurst, float delay, std::complex<float> scale = 1.0f);
 
 /** Add two vectors in-place */
-bool addVector(signalVector &x, signalVector &y);
+bool addVector(signalVector &x, const signalVector &y);
 
 /** Multiply two vectors in-place*/
 bool multVector(signalVector &x, signalVector &y);
@@ -172,6 +201,20 @@ std::complex<float> interpolatePoint(const signalVector &inSig, float ix);
 */
 std::complex<float> peakDetect(const signalVector &rxBurst, float * peakIndex, float * avgPwr);
 
+/** Sub-sample peak estimators for peakDetect() */
+enum PeakEstimator {
+    PEAK_SINC_SEARCH,   ///< iterative early-late search on sinc interpolated points
+    PEAK_SECANT,        ///< parabolic start and secant steps on table interpolated points
+};
+
+/**
+	Select the estimator used by peakDetect() and burst detection.
+	Midamble and RACH references are timed with the estimator in use
+	when they are generated, so select it before sigProcLibSetup().
+	@param est The peak estimator, PEAK_SECANT by default.
+*/
+void setPeakEstimator(PeakEstimator est);
+
 /**
         Apply a scalar to a vector.
         @param x The vector of interest.
@@ -234,7 +277,8 @@ int detectRACHBurst(signalVector &rxBurst, float detectThreshold, int sps, std::
         @param TOA The estimate time-of-arrival of received TSC burst.
         @param maxTOA The maximum expected time-of-arrival
         @param requestChannel Set to true if channel estimation is desired.
-        @param channelResponse The estimated channel.
+        @param channelResponse The least squares channel estimate, symbol spaced taps taken from the midamble.
+               An existing vector of the estimate length is overwritten, otherwise it is replaced.
         @param channelResponseOffset The time offset b/w the first sample of the channel response and the reported TOA.
         @return positive if threshold value is reached, negative on error, zero otherwise
 */
@@ -242,6 +286,21 @@ int analyzeTrafficBurst(signalVector &rxBurst, unsigned TSC, float detectThresho
                         std::complex<float> * amplitude, float * TOA, unsigned maxTOA, bool requestChannel = false,
                         signalVector ** channelResponse = nullptr, float * channelResponseOffset = nullptr);
 
+/**
+        Blind version of analyzeTrafficBurst() that correlates the burst against every training sequence
+        in a single pass over the correlation window. sigProcLibSetup() generates all eight at 1 sps.
+        @param rxBurst The received GSM burst of interest.
+        @param detectThreshold The threshold that the received burst's post-correlator SNR is compared against to determine validity.
+        @param sps The number of samples per GSM symbol.
+        @param amplitude Array of 8 channel amplitude estimates, indexed by TSC and zero where not detected.
+        @param TOA Array of 8 times-of-arrival, indexed by TSC and zero where not detected.
+        @param ratio Array of 8 peak-to-average ratios, indexed by TSC and zero without a usable peak.
+        @param maxTOA The maximum expected time-of-arrival
+        @return bit mask of the detected TSCs, negative on error
+*/
+int analyzeTrafficBurstTSCs(signalVector &rxBurst, float detectThreshold, int sps, std::complex<float> * amplitude,
+                            float * TOA, float * ratio, unsigned maxTOA);
+
 /**
 	Decimate a vector.
         @param wVector The vector of interest.
@@ -261,14 +320,38 @@ signalVector * decimateVector(signalVector &wVector, int decimationFactor);
 */
 SoftVector * demodulateBurst(signalVector &rxBurst, int sps, std::complex<float> channel, float TOA);
 
+/**
+        Demodulates a received burst into preallocated soft bits, the burst is
+        used as scratch space and nothing is allocated.
+	@param rxBurst The burst to be demodulated.
+        @param sps The number of samples per GSM symbol.
+        @param channel The amplitude estimate of the received burst.
+        @param TOA The time-of-arrival of the received burst.
+        @param bits The output, the first bits.size() soft bits of the burst are written.
+*/
+void demodulateBurst(signalVector &rxBurst, int sps, std::complex<float> channel, float TOA, SoftVector &bits);
+
+/**
+        Demodulates a received burst straight to soft bits in the wire format,
+        one byte per bit from 0 to 255, in a single pass over the burst.
+	@param rxBurst The burst to be demodulated, left untouched.
+        @param sps The number of samples per GSM symbol.
+        @param channel The amplitude estimate of the received burst.
+        @param TOA The time-of-arrival of the received burst.
+        @param bits The output, len soft bits are written.
+        @param len The number of soft bits to write.
+*/
+void demodulateBurst(const signalVector &rxBurst, int sps, std::complex<float> channel, float TOA,
+                     unsigned char * bits, size_t len);
+
 /**
 	Design the necessary filters for a decision-feedback equalizer.
 	@param channelResponse The multipath channel that we're mitigating.
 	@param SNRestimate The signal-to-noise estimate of the channel, a linear value
 	@param Nf The number of taps in the feedforward filter.
-	@param feedForwardFilter The designed feed forward filter.
-	@param feedbackFilter The designed feedback filter.
-	@return True if DFE can be designed.
+	@param feedForwardFilter The designed feed forward filter, an existing filter of Nf taps is redesigned in place.
+	@param feedbackFilter The designed feedback filter, an existing filter of the right length is redesigned in place.
+	@return True if DFE can be designed, which needs a channel shorter than Nf of at most 16 taps.
 */
 bool designDFE(signalVector &channelResponse, float SNRestimate, int Nf, signalVector ** feedForwardFilter, signalVector ** feedbackFilter);
 
@@ -283,4 +366,34 @@ bool designDFE(signalVector &channelResponse, float SNRestimate, int Nf, signalV
 */
 SoftVector * equalizeBurst(signalVector &rxBurst, float TOA, int sps, signalVector &w, signalVector &b);
 
+/**
+	Equalize/demodulate a received burst via a decision-feedback equalizer
+	straight to soft bits in the wire format, one byte per bit from 0 to 255.
+	Filtering uses per-thread scratch space and nothing is allocated.
+	@param rxBurst The received burst, used as scratch space.
+	@param TOA The time-of-arrival of the received burst.
+	@param sps The number of samples per GSM symbol.
+	@param w The feed forward filter of the DFE.
+	@param b The feedback filter of the DFE.
+	@param bits The output, len soft bits are written.
+	@param len The number of soft bits to write.
+	@return False if the burst could not be filtered, bits are then left untouched.
+*/
+bool equalizeBurst(signalVector &rxBurst, float TOA, int sps, signalVector &w, signalVector &b,
+                   unsigned char * bits, size_t len);
+
+/**
+        Maximum likelihood sequence estimation of a received burst with a
+        Viterbi equalizer, over up to five symbol spaced channel taps.
+        @param rxBurst The received burst, used as scratch space.
+        @param TOA The time-of-arrival of the first channel tap, in samples.
+        @param sps The number of samples per GSM symbol.
+        @param channel The channel estimate, taps are taken every sps samples.
+        @param bits The output, len soft bits from 0 to 255 are written.
+        @param len The number of soft bits to write.
+        @return False if the channel estimate spans fewer than two symbols or is empty, bits are then left untouched.
+*/
+bool equalizeBurstMLSE(signalVector &rxBurst, float TOA, int sps, const signalVector &channel,
+                       unsigned char * bits, size_t len);
+
 #endif //OBTS_TRANSCEIVER52M_SIGPROCLIB_H
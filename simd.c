@@ -0,0 +1,30 @@
+/*
+ * Runtime CPU feature detection for the SIMD kernels
+ */
+
+#include "simd.h"
+
+int simd_probe(void)
+{
+	static int flags = -1;
+
+	if (flags >= 0)
+		return flags;
+
+	flags = 0;
+
+#ifdef HAVE_SIMD_X86
+	__builtin_cpu_init();
+
+	if (__builtin_cpu_supports("sse3"))
+		flags |= SIMD_SSE3;
+	if (__builtin_cpu_supports("sse4.1"))
+		flags |= SIMD_SSE4_1;
+	if (__builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma"))
+		flags |= SIMD_AVX2;
+	if ((flags & SIMD_AVX2) && __builtin_cpu_supports("avx512f"))
+		flags |= SIMD_AVX512;
+#endif
+
+	return flags;
+}
@@ -0,0 +1,24 @@
+#ifndef _SIMD_H_
+#define _SIMD_H_
+
+/*
+ * Instruction set extensions available to the runtime dispatched kernels.
+ * Kernels are compiled with per-function target attributes, so the build
+ * does not need any -m flags and the widest usable set is picked at setup.
+ */
+enum simd_flags {
+	SIMD_SSE3	= 1 << 0,
+	SIMD_SSE4_1	= 1 << 1,
+	SIMD_AVX2	= 1 << 2,	/* AVX2 with FMA */
+	SIMD_AVX512	= 1 << 3,	/* AVX-512 Foundation */
+};
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define HAVE_SIMD_X86
+#define SIMD_TARGET(isa)	__attribute__((target(isa)))
+#endif
+
+/* Probe (once) and return the supported simd_flags of the running CPU */
+int simd_probe(void);
+
+#endif /* _SIMD_H_ */
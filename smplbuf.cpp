@@ -1,10 +1,11 @@
 #include "smplbuf.h"
 
+#include <algorithm>
 #include <sstream>
 #include <cstring>
 
 smpl_buf::smpl_buf(size_t len, double rate) : m_buf_len(len), m_clk_rt(rate) {
-    m_data = new uint32_t[len];
+    m_data = new uint32_t[len]();
 }
 
 smpl_buf::~smpl_buf() {
@@ -12,111 +13,149 @@ smpl_buf::~smpl_buf() {
 }
 
 ssize_t smpl_buf::avail_smpls(TIMESTAMP timestamp) const {
-    if (timestamp < m_time_start)
+    TIMESTAMP time_end = m_time_end.load(std::memory_order_acquire);
+
+    if (timestamp < m_time_start.load(std::memory_order_relaxed))
         return ERROR_TIMESTAMP;
-    else if (timestamp >= m_time_end)
+    else if (timestamp >= time_end)
         return 0;
     else
-        return m_time_end - timestamp;
+        return time_end - timestamp;
 }
 
 ssize_t smpl_buf::avail_smpls(uhd::time_spec_t ts) const {
     return avail_smpls(ts.to_ticks(m_clk_rt));
 }
 
-// FIXME: Not a fan of using a bunch of `memcpy`.  Should make this use more modern data structures in the future.
+ssize_t smpl_buf::wait_smpls(TIMESTAMP timestamp, size_t len) {
+    while (true) {
+        // Sample the sequence first so a write or cancel after the checks still wakes us
+        uint32_t seq = m_seq.load(std::memory_order_acquire);
+        ssize_t avail = avail_smpls(timestamp);
+
+        if ((avail < 0) || ((size_t) avail >= len) || m_cancelled.load(std::memory_order_relaxed))
+            return avail;
+
+        m_seq.wait(seq, std::memory_order_acquire);
+    }
+}
+
 ssize_t smpl_buf::read(void *buf, size_t len, TIMESTAMP timestamp) {
-    int type_sz = 2 * sizeof(short);
+    ssize_t avail = avail_smpls(timestamp);
 
     // Check for valid read
-    if (timestamp < m_time_start)
-        return ERROR_TIMESTAMP;
-    if (timestamp >= m_time_end)
-        return 0;
+    if (avail < 0)
+        return avail;
     if (len >= m_buf_len)
         return ERROR_READ;
 
     // How many samples should be copied
-    size_t num_smpls = m_time_end - timestamp;
-    if (num_smpls > len)
-        num_smpls = len;
-
-    // Starting index
-    size_t read_start = m_data_start + (timestamp - m_time_start);
+    size_t num_smpls = std::min((size_t) avail, len);
+    if (!num_smpls)
+        return 0;
 
-    // Read it
-    if (read_start + num_smpls < m_buf_len) {
-        size_t numBytes = len * type_sz;
-        memcpy(buf, m_data + read_start, numBytes);
-    } else {
-        size_t first_cp = (m_buf_len - read_start) * type_sz;
-        size_t second_cp = len * type_sz - first_cp;
+    // Read it, in two parts if it wraps
+    size_t read_start = timestamp % m_buf_len;
+    size_t first_cp = std::min(num_smpls, m_buf_len - read_start);
 
-        memcpy(buf, m_data + read_start, first_cp);
-        memcpy((char *) buf + first_cp, m_data, second_cp);
-    }
+    memcpy(buf, m_data + read_start, first_cp * sizeof(uint32_t));
+    memcpy((uint32_t *) buf + first_cp, m_data, (num_smpls - first_cp) * sizeof(uint32_t));
 
-    m_data_start = (read_start + len) % m_buf_len;
-    m_time_start = timestamp + len;
+    // Hand the space back to the writer only after the copy
+    m_time_start.store(timestamp + num_smpls, std::memory_order_release);
 
-    if (m_time_start > m_time_end)
-        return ERROR_READ;
-    else
-        return num_smpls;
+    return num_smpls;
 }
 
 ssize_t smpl_buf::read(void *buf, size_t len, uhd::time_spec_t ts) {
     return read(buf, len, ts.to_ticks(m_clk_rt));
 }
 
-ssize_t smpl_buf::write(void *buf, size_t len, TIMESTAMP timestamp) {
-    int type_sz = 2 * sizeof(short);
+void smpl_buf::copy_in(TIMESTAMP timestamp, const uint32_t *buf, size_t len) {
+    size_t write_start = timestamp % m_buf_len;
+    size_t first_cp = std::min(len, m_buf_len - write_start);
+
+    memcpy(m_data + write_start, buf, first_cp * sizeof(uint32_t));
+    memcpy(m_data, buf + first_cp, (len - first_cp) * sizeof(uint32_t));
+}
+
+void smpl_buf::zero_fill(TIMESTAMP timestamp, size_t len) {
+    size_t write_start = timestamp % m_buf_len;
+    size_t first_cp = std::min(len, m_buf_len - write_start);
+
+    memset(m_data + write_start, 0, first_cp * sizeof(uint32_t));
+    memset(m_data, 0, (len - first_cp) * sizeof(uint32_t));
+}
+
+ssize_t smpl_buf::write(const void *buf, size_t len, TIMESTAMP timestamp) {
+    const uint32_t * data = (const uint32_t *) buf;
+    ssize_t rc = len;
 
     // Check for valid write
     if ((len == 0) || (len >= m_buf_len))
         return ERROR_WRITE;
-    if ((timestamp + len) <= m_time_end)
+
+    // Everything from the reader's start time onwards may be unread
+    TIMESTAMP time_start = m_time_start.load(std::memory_order_acquire);
+    TIMESTAMP time_end = std::max(m_time_end.load(std::memory_order_relaxed), time_start);
+    TIMESTAMP limit = time_start + m_buf_len;
+
+    if ((timestamp + len) <= time_end)
         return ERROR_TIMESTAMP;
 
-    // Starting index
-    size_t write_start = (m_data_start + (timestamp - m_time_start)) % m_buf_len;
+    // Skip samples that were already written or are no longer wanted
+    if (timestamp < time_end) {
+        size_t skip = time_end - timestamp;
 
-    // Write it
-    if ((write_start + len) < m_buf_len) {
-        size_t numBytes = len * type_sz;
-        memcpy(m_data + write_start, buf, numBytes);
-    } else {
-        size_t first_cp = (m_buf_len - write_start) * type_sz;
-        size_t second_cp = len * type_sz - first_cp;
+        data += skip;
+        len -= skip;
+        timestamp = time_end;
+    }
+
+    // Samples lost before this packet read back as zeros, as far as there is room
+    if (timestamp > time_end) {
+        TIMESTAMP fill_end = std::min(timestamp, limit);
 
-        memcpy(m_data + write_start, buf, first_cp);
-        memcpy(m_data, (char *) buf + first_cp, second_cp);
+        zero_fill(time_end, fill_end - time_end);
+        time_end = fill_end;
     }
 
-    m_data_end = (write_start + len) % m_buf_len;
-    m_time_end = timestamp + len;
+    // Drop the packet rather than overwrite samples the reader has not consumed
+    if ((timestamp + len) > limit) {
+        rc = ERROR_OVERFLOW;
+    } else {
+        copy_in(timestamp, data, len);
+        time_end = timestamp + len;
+    }
 
-    if (((write_start + len) > m_buf_len) && (m_data_end > m_data_start))
-        return ERROR_OVERFLOW;
-    else if (m_time_end <= m_time_start)
-        return ERROR_WRITE;
-    else
-        return len;
+    m_time_end.store(time_end, std::memory_order_release);
+    m_seq.fetch_add(1, std::memory_order_release);
+    m_seq.notify_one();
+
+    return rc;
 }
 
-ssize_t smpl_buf::write(void *buf, size_t len, uhd::time_spec_t ts) {
+ssize_t smpl_buf::write(const void *buf, size_t len, uhd::time_spec_t ts) {
     return write(buf, len, ts.to_ticks(m_clk_rt));
 }
 
+void smpl_buf::cancel() {
+    m_cancelled.store(true, std::memory_order_relaxed);
+    m_seq.fetch_add(1, std::memory_order_release);
+    m_seq.notify_all();
+}
+
+void smpl_buf::resume() {
+    m_cancelled.store(false, std::memory_order_relaxed);
+}
+
 // FIXME: Seems like string formatting would be better here.
 std::string smpl_buf::str_status() const {
     std::ostringstream ost("Sample buffer: ");
 
     ost << "length = " << m_buf_len;
-    ost << ", time_start = " << m_time_start;
-    ost << ", time_end = " << m_time_end;
-    ost << ", data_start = " << m_data_start;
-    ost << ", data_end = " << m_data_end;
+    ost << ", time_start = " << m_time_start.load(std::memory_order_relaxed);
+    ost << ", time_end = " << m_time_end.load(std::memory_order_relaxed);
 
     return ost.str();
 }
@@ -135,4 +174,3 @@ std::string smpl_buf::str_code(ssize_t code) {
             return "Sample buffer: Unknown error";
     }
 }
-
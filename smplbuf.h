@@ -1,13 +1,20 @@
 #ifndef OBTS_TRANSCEIVER52M_SMPLBUF_H
 #define OBTS_TRANSCEIVER52M_SMPLBUF_H
 
+#include <atomic>
 #include <cstdint>
 #include <uhd/types/time_spec.hpp>
 #include "radioDevice.h"
 
 /*
     Sample Buffer - Allows reading and writing of timed samples using OpenBTS
-                    or UHD style timestamps.
+                    or UHD style timestamps. Samples are stored at their
+                    timestamp modulo the buffer length. The buffer is lock-free
+                    for a single writer and a single reader: the writer only
+                    advances the end time and the reader only advances the
+                    start time, so neither side ever touches samples the other
+                    owns. A write that would overtake unread samples is dropped
+                    and later reads see zeros in its place.
 */
 // FIXME: Should this be templated and put into its own file?
 class smpl_buf {
@@ -22,13 +29,16 @@ public:
     /** Sample buffer constructor
         @param len number of 32-bit samples the buffer should hold
         @param rate sample clockrate
-        @param timestamp
     */
     smpl_buf(std::size_t len, double rate);
 
     ~smpl_buf();
 
-    /** Query number of samples available for reading
+    smpl_buf(const smpl_buf &) = delete;
+
+    smpl_buf &operator=(const smpl_buf &) = delete;
+
+    /** Query number of samples available for reading, reader side only
         @param timestamp time of first sample
         @return number of available samples or error
     */
@@ -36,7 +46,17 @@ public:
 
     [[nodiscard]] ssize_t avail_smpls(uhd::time_spec_t timestamp) const;
 
-    /** Read and write
+    /** Block until samples are available, reader side only
+        @param timestamp time of first sample
+        @param len number of samples to wait for
+        @return number of available samples, fewer than len if cancelled, or error
+    */
+    ssize_t wait_smpls(TIMESTAMP timestamp, size_t len);
+
+    /** Time one past the newest buffered sample, safe from any thread */
+    [[nodiscard]] TIMESTAMP time_end() const { return m_time_end.load(std::memory_order_relaxed); }
+
+    /** Read and write, read is reader side only and write is writer side only
         @param buf pointer to buffer
         @param len number of samples desired to read or write
         @param timestamp time of first stample
@@ -46,9 +66,15 @@ public:
 
     ssize_t read(void * buf, size_t len, uhd::time_spec_t timestamp);
 
-    ssize_t write(void * buf, size_t len, TIMESTAMP timestamp);
+    ssize_t write(const void * buf, size_t len, TIMESTAMP timestamp);
 
-    ssize_t write(void * buf, size_t len, uhd::time_spec_t timestamp);
+    ssize_t write(const void * buf, size_t len, uhd::time_spec_t timestamp);
+
+    /** Wake a waiting reader and stop further waits until resume() */
+    void cancel();
+
+    /** Allow wait_smpls() to block again */
+    void resume();
 
     /** Buffer status string
         @return a formatted string describing internal buffer state
@@ -66,11 +92,19 @@ private:
     size_t m_buf_len;
     double m_clk_rt;
 
-    TIMESTAMP m_time_start = 0;
-    TIMESTAMP m_time_end = 0;
+    void copy_in(TIMESTAMP timestamp, const uint32_t * buf, size_t len);
+
+    void zero_fill(TIMESTAMP timestamp, size_t len);
+
+    // Oldest sample still needed by the reader, written by the reader only
+    alignas(64) std::atomic<TIMESTAMP> m_time_start{0};
+
+    // One past the newest sample, written by the writer only
+    alignas(64) std::atomic<TIMESTAMP> m_time_end{0};
 
-    size_t m_data_start = 0;
-    size_t m_data_end = 0;
+    // Bumped on every write or cancel to wake a waiting reader
+    std::atomic<uint32_t> m_seq{0};
+    std::atomic<bool> m_cancelled{false};
 };
 
 #endif //OBTS_TRANSCEIVER52M_SMPLBUF_H
@@ -0,0 +1,208 @@
+/*
+ * SIMD Trellis Add-Compare-Select
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+#include <stddef.h>
+#include <string.h>
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include "trellis.h"
+#include "simd.h"
+
+/* Base add-compare-select step */
+static unsigned base_acs(const float *pred, const float *y,
+			 const float *pm_in, float *pm_out, int num_states)
+{
+	const float *pred_re = pred;
+	const float *pred_im = &pred[2 * num_states];
+	unsigned dec = 0;
+
+	for (int s = 0; s < num_states; s++) {
+		int h0 = s, h1 = s + num_states;
+		float d0_re = y[0] - pred_re[h0], d0_im = y[1] - pred_im[h0];
+		float d1_re = y[0] - pred_re[h1], d1_im = y[1] - pred_im[h1];
+		float m0 = pm_in[s >> 1] + d0_re * d0_re + d0_im * d0_im;
+		float m1 = pm_in[(s >> 1) | (num_states >> 1)] +
+			   d1_re * d1_re + d1_im * d1_im;
+
+		if (m1 < m0) {
+			pm_out[s] = m1;
+			dec |= 1u << s;
+		} else {
+			pm_out[s] = m0;
+		}
+	}
+
+	return dec;
+}
+
+/* Base forward pass, alternating between two metric buffers */
+static void base_forward(const float *pred, const float *y, int len,
+			 float *pm, unsigned *dec, int num_states)
+{
+	float tmp[TRELLIS_MAX_STATES];
+
+	for (int n = 0; n < len; n++) {
+		dec[n] = base_acs(pred, &y[2 * n], pm, tmp, num_states);
+		memcpy(pm, tmp, num_states * sizeof(float));
+	}
+}
+
+#ifdef HAVE_SIMD_X86
+#include <immintrin.h>
+
+/* Squared distance of y to 8 planar hypotheses */
+SIMD_TARGET("avx2,fma")
+static inline __m256 avx2_dist(const float *re, const float *im,
+			       __m256 y_re, __m256 y_im)
+{
+	__m256 m0 = _mm256_sub_ps(y_re, _mm256_loadu_ps(re));
+	__m256 m1 = _mm256_sub_ps(y_im, _mm256_loadu_ps(im));
+
+	return _mm256_fmadd_ps(m0, m0, _mm256_mul_ps(m1, m1));
+}
+
+/* Select the smaller of two candidate metric vectors, returns the decisions */
+SIMD_TARGET("avx2")
+static inline unsigned avx2_select(__m256 m0, __m256 m1, __m256 *out)
+{
+	__m256 lt = _mm256_cmp_ps(m1, m0, _CMP_LT_OQ);
+
+	*out = _mm256_blendv_ps(m0, m1, lt);
+
+	return (unsigned) _mm256_movemask_ps(lt);
+}
+
+/*
+ * AVX2/FMA butterflies with the path metrics held in registers for the
+ * whole burst. Each predecessor metric feeds two neighbouring states, so
+ * half a register of metrics is spread across all 8 lanes.
+ */
+SIMD_TARGET("avx2,fma")
+static int avx2_forward(const float *pred, const float *y, int len,
+			float *pm, unsigned *dec, int num_states)
+{
+	const float *re = pred;
+	const float *im = &pred[2 * num_states];
+	const __m256i lo = _mm256_setr_epi32(0, 0, 1, 1, 2, 2, 3, 3);
+	const __m256i hi = _mm256_setr_epi32(4, 4, 5, 5, 6, 6, 7, 7);
+	__m256 a, b;
+
+	switch (num_states) {
+	case 8:
+		a = _mm256_loadu_ps(pm);
+
+		for (int n = 0; n < len; n++) {
+			__m256 y_re = _mm256_set1_ps(y[2 * n + 0]);
+			__m256 y_im = _mm256_set1_ps(y[2 * n + 1]);
+
+			dec[n] = avx2_select(
+				_mm256_add_ps(_mm256_permutevar8x32_ps(a, lo),
+					      avx2_dist(&re[0], &im[0], y_re, y_im)),
+				_mm256_add_ps(_mm256_permutevar8x32_ps(a, hi),
+					      avx2_dist(&re[8], &im[8], y_re, y_im)),
+				&a);
+		}
+
+		_mm256_storeu_ps(pm, a);
+		return 0;
+	case 16:
+		a = _mm256_loadu_ps(&pm[0]);
+		b = _mm256_loadu_ps(&pm[8]);
+
+		for (int n = 0; n < len; n++) {
+			__m256 y_re = _mm256_set1_ps(y[2 * n + 0]);
+			__m256 y_im = _mm256_set1_ps(y[2 * n + 1]);
+			unsigned d0, d1;
+
+			/* States 0-7 come from 0-3 or 8-11, states 8-15 from 4-7 or 12-15 */
+			__m256 a0 = _mm256_permutevar8x32_ps(a, lo);
+			__m256 a1 = _mm256_permutevar8x32_ps(a, hi);
+			__m256 b0 = _mm256_permutevar8x32_ps(b, lo);
+			__m256 b1 = _mm256_permutevar8x32_ps(b, hi);
+
+			d0 = avx2_select(
+				_mm256_add_ps(a0, avx2_dist(&re[0], &im[0], y_re, y_im)),
+				_mm256_add_ps(b0, avx2_dist(&re[16], &im[16], y_re, y_im)),
+				&a);
+			d1 = avx2_select(
+				_mm256_add_ps(a1, avx2_dist(&re[8], &im[8], y_re, y_im)),
+				_mm256_add_ps(b1, avx2_dist(&re[24], &im[24], y_re, y_im)),
+				&b);
+
+			dec[n] = d0 | (d1 << 8);
+		}
+
+		_mm256_storeu_ps(&pm[0], a);
+		_mm256_storeu_ps(&pm[8], b);
+		return 0;
+	}
+
+	return -1;
+}
+#endif /* HAVE_SIMD_X86 */
+
+/*
+ * Trellis kernel registry, ordered from widest to narrowest instruction
+ * set. Kernels return negative for unsupported state counts, in which case
+ * the base implementation is used.
+ */
+struct trellis_backend {
+	const char *name;
+	int flags;
+	int (*forward)(const float *pred, const float *y, int len,
+		       float *pm, unsigned *dec, int num_states);
+};
+
+static const struct trellis_backend trellis_backends[] = {
+#ifdef HAVE_SIMD_X86
+	{ "AVX2/FMA", SIMD_AVX2, avx2_forward },
+#endif
+	{ "generic", 0, NULL },
+};
+
+#define NUM_TRELLIS_BACKENDS \
+	(sizeof(trellis_backends) / sizeof(trellis_backends[0]))
+
+static const struct trellis_backend *trellis_backend =
+	&trellis_backends[NUM_TRELLIS_BACKENDS - 1];
+
+/* API: Select the widest kernel set supported by the running CPU */
+const char *trellis_init(void)
+{
+	int flags = simd_probe();
+
+	for (size_t i = 0; i < NUM_TRELLIS_BACKENDS; i++) {
+		if ((trellis_backends[i].flags & flags) == trellis_backends[i].flags) {
+			trellis_backend = &trellis_backends[i];
+			break;
+		}
+	}
+
+	return trellis_backend->name;
+}
+
+void trellis_forward(const float *pred, const float *y, int len, float *pm,
+		     unsigned *dec, int num_states)
+{
+	if (!trellis_backend->forward ||
+	    trellis_backend->forward(pred, y, len, pm, dec, num_states))
+		base_forward(pred, y, len, pm, dec, num_states);
+}
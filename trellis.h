@@ -0,0 +1,28 @@
+#ifndef _TRELLIS_H_
+#define _TRELLIS_H_
+
+/*
+ * Maximum likelihood sequence estimation over a binary trellis. A state of
+ * memory L holds the last L symbols with the newest in bit 0, a set bit is
+ * the symbol -1. Hypothesis h of 2 * num_states is a state extended by one
+ * older symbol, bit j is the symbol j steps before the newest.
+ */
+#define TRELLIS_MAX_MEMORY	4
+#define TRELLIS_MAX_STATES	(1 << TRELLIS_MAX_MEMORY)
+
+/* Probe the CPU and select trellis kernels, returns the kernel set name */
+const char *trellis_init(void);
+
+/*
+ * Viterbi forward pass over len received complex samples y. pred holds the
+ * expected output of every hypothesis, the 2 * num_states real parts
+ * followed by the imaginary parts. State s is reached from s >> 1 or from
+ * (s >> 1) | (num_states / 2), the branch metric being the squared distance
+ * to hypothesis s or s + num_states. The path metrics in pm are updated in
+ * place and dec[n] receives the decision bits of step n, bit s set when
+ * state s survives from the second predecessor.
+ */
+void trellis_forward(const float *pred, const float *y, int len, float *pm,
+		     unsigned *dec, int num_states);
+
+#endif /* _TRELLIS_H_ */
@@ -0,0 +1,105 @@
+#include "txbuf.h"
+
+#include <cstring>
+
+tx_buf::~tx_buf() {
+    delete[] m_slots;
+}
+
+bool tx_buf::init(size_t len, size_t num_slots) {
+    if (!m_ring.init(len * sizeof(uint32_t)))
+        return false;
+
+    m_len = m_ring.size() / sizeof(uint32_t);
+    m_num_slots = num_slots;
+
+    delete[] m_slots;
+    m_slots = new slot[num_slots]();
+
+    m_head = 0;
+    m_data_head = 0;
+    m_tail = 0;
+    m_data_tail = 0;
+
+    return true;
+}
+
+ssize_t tx_buf::write(const void *buf, size_t len, TIMESTAMP timestamp) {
+    if ((len == 0) || (len > m_len))
+        return ERROR_WRITE;
+
+    // Both a slot and room for all samples, so a partial buffer never reaches the device
+    size_t tail = m_tail.load(std::memory_order_relaxed);
+    size_t data_tail = m_data_tail.load(std::memory_order_relaxed);
+
+    if (tail - m_head.load(std::memory_order_acquire) >= m_num_slots)
+        return ERROR_OVERFLOW;
+    if (data_tail + len - m_data_head.load(std::memory_order_acquire) > m_len)
+        return ERROR_OVERFLOW;
+
+    // The mirror keeps the buffer contiguous across the end of the ring
+    slot &s = m_slots[tail % m_num_slots];
+    s.timestamp = timestamp;
+    s.len = len;
+    s.data = (uint32_t *) m_ring.data() + data_tail % m_len;
+    memcpy(s.data, buf, len * sizeof(uint32_t));
+
+    m_data_tail.store(data_tail + len, std::memory_order_relaxed);
+    m_tail.store(tail + 1, std::memory_order_release);
+    m_seq.fetch_add(1, std::memory_order_release);
+    m_seq.notify_one();
+
+    return len;
+}
+
+tx_buf::slot * tx_buf::wait_front() {
+    size_t head = m_head.load(std::memory_order_relaxed);
+
+    while (true) {
+        // Sample the sequence first so a write or cancel after the checks still wakes us
+        uint32_t seq = m_seq.load(std::memory_order_acquire);
+
+        if (m_tail.load(std::memory_order_acquire) != head)
+            return &m_slots[head % m_num_slots];
+        if (m_cancelled.load(std::memory_order_relaxed))
+            return nullptr;
+
+        m_seq.wait(seq, std::memory_order_acquire);
+    }
+}
+
+void tx_buf::pop() {
+    size_t head = m_head.load(std::memory_order_relaxed);
+    size_t len = m_slots[head % m_num_slots].len;
+
+    m_data_head.store(m_data_head.load(std::memory_order_relaxed) + len, std::memory_order_release);
+    m_head.store(head + 1, std::memory_order_release);
+}
+
+size_t tx_buf::depth() const {
+    size_t data_head = m_data_head.load(std::memory_order_relaxed);
+    size_t data_tail = m_data_tail.load(std::memory_order_relaxed);
+
+    return (data_tail > data_head) ? data_tail - data_head : 0;
+}
+
+void tx_buf::cancel() {
+    m_cancelled.store(true, std::memory_order_relaxed);
+    m_seq.fetch_add(1, std::memory_order_release);
+    m_seq.notify_all();
+}
+
+void tx_buf::resume() {
+    m_cancelled.store(false, std::memory_order_relaxed);
+}
+
+std::string tx_buf::str_code(ssize_t code) {
+    switch (code) {
+        case ERROR_WRITE:
+            return "Transmit buffer: Write error";
+        case ERROR_OVERFLOW:
+            return "Transmit buffer: Queue full";
+        default:
+            return "Transmit buffer: Unknown error";
+    }
+}
@@ -0,0 +1,102 @@
+#ifndef OBTS_TRANSCEIVER52M_TXBUF_H
+#define OBTS_TRANSCEIVER52M_TXBUF_H
+
+#include <atomic>
+#include <cstdint>
+#include <string>
+#include "radioDevice.h"
+#include "mirrorRing.h"
+
+/*
+    Transmit Buffer - Bounded queue of timestamped sample buffers waiting to
+                      be sent to the device. Buffers are packed back to back
+                      in a mirrored sample ring, so every buffer is contiguous
+                      whatever its length and the capacity is the same number
+                      of samples for any write size. The queue is lock-free
+                      for a single writer and a single reader: the writer only
+                      advances the tails and the reader only advances the
+                      heads. A write that does not fit is refused rather than
+                      waited for.
+*/
+class tx_buf {
+public:
+    enum err_code {
+        ERROR_WRITE = -1,
+        ERROR_OVERFLOW = -2
+    };
+
+    struct slot {
+        TIMESTAMP timestamp;
+        size_t len;
+        uint32_t * data;
+    };
+
+    tx_buf() = default;
+
+    ~tx_buf();
+
+    tx_buf(const tx_buf &) = delete;
+
+    tx_buf &operator=(const tx_buf &) = delete;
+
+    /** Allocate the queue
+        @param len number of 32-bit samples the queue should hold, rounded up to whole pages
+        @param num_slots number of buffers the queue can hold
+        @return false on failure
+    */
+    bool init(size_t len, size_t num_slots);
+
+    /** Queue a buffer, writer side only
+        @param buf pointer to buffer
+        @param len number of samples to queue
+        @param timestamp time of first sample
+        @return number of samples queued or error, nothing is queued on error
+    */
+    ssize_t write(const void * buf, size_t len, TIMESTAMP timestamp);
+
+    /** Block until a buffer is queued, reader side only
+        @return oldest queued buffer, or nullptr if cancelled
+    */
+    slot * wait_front();
+
+    /** Release the oldest buffer back to the writer, reader side only */
+    void pop();
+
+    /** Number of samples queued and not yet popped */
+    size_t depth() const;
+
+    /** Number of samples the queue holds */
+    size_t capacity() const { return m_len; }
+
+    /** Wake a waiting reader and stop further waits until resume() */
+    void cancel();
+
+    /** Allow wait_front() to block again */
+    void resume();
+
+    /** Formatted error string
+        @param code an error code
+        @return a formatted error string
+    */
+    static std::string str_code(ssize_t code);
+
+private:
+    MirrorRing m_ring;
+    slot * m_slots = nullptr;
+    size_t m_len = 0;
+    size_t m_num_slots = 0;
+
+    // Oldest queued slot and its first sample, written by the reader only
+    alignas(64) std::atomic<size_t> m_head{0};
+    std::atomic<size_t> m_data_head{0};
+
+    // Next free slot and sample, written by the writer only
+    alignas(64) std::atomic<size_t> m_tail{0};
+    std::atomic<size_t> m_data_tail{0};
+
+    // Bumped on every write or cancel to wake a waiting reader
+    alignas(64) std::atomic<uint32_t> m_seq{0};
+    std::atomic<bool> m_cancelled{false};
+};
+
+#endif //OBTS_TRANSCEIVER52M_TXBUF_H
@@ -4,6 +4,9 @@
 #include "radioDevice.h"
 #include "Threads.h"
 #include "smplbuf.h"
+#include "txbuf.h"
+
+#include <atomic>
 
 #include <uhd/version.hpp>
 #include <uhd/property_tree.hpp>
@@ -15,7 +18,9 @@
 #define B100_BASE_RT     400000
 #define USRP2_BASE_RT    390625
 #define TX_AMPL          0.3
-#define SAMPLE_BUF_SZ    (1 << 20)
+#define SAMPLE_BUF_SZ    (1 << 20)  // about one second of receive samples at the base rate
+#define TX_QUEUE_LEN     (1 << 18)  // transmit samples, about a quarter second at 4 SPS
+#define TX_QUEUE_SLOTS   1024       // buffers, enough to fill the queue with the shortest resampled writes
 
 enum uhd_dev_type {
     USRP1,
@@ -73,10 +78,14 @@ static struct uhd_dev_offset uhd_offsets[NUM_USRP_TYPES * 2] = {
 
 /*
     uhd_device - UHD implementation of the Device interface. Timestamped samples
-                are sent to and received from the device. An intermediate buffer
-                on the receive side collects and aligns packets of samples.
-                Events and errors such as underruns are reported asynchronously
-                by the device and received in a separate thread.
+                are sent to and received from the device. A dedicated receive
+                thread streams packets from the device into an intermediate
+                buffer that aligns them by timestamp, so slow readers do not
+                delay the device. Likewise a dedicated transmit thread sends
+                queued buffers, so slow transports do not delay modulation.
+                Events and errors such as underruns are
+                reported asynchronously by the device and received in a
+                separate thread.
 */
 class uhd_device : public RadioDevice {
 public:
@@ -123,11 +132,24 @@ public:
     inline double numberRead() override { return rx_pkt_cnt; }
     inline double numberWritten() override { return 0; }
 
+    size_t txQueueDepth() override { return tx_queue ? tx_queue->depth() : 0; }
+    size_t txQueueCapacity() override { return tx_queue ? tx_queue->capacity() : 0; }
+
     /** Receive and process asynchronous message
         @return true if message received or false on timeout or error
     */
     bool recv_async_msg();
 
+    /** Receive one packet from the device into the receive buffer
+        @return false once the receive thread should exit
+    */
+    bool recv_rx_pkt();
+
+    /** Send one queued buffer to the device
+        @return false once the transmit thread should exit
+    */
+    bool send_tx_pkt();
+
     enum err_code {
         ERROR_TIMING = -1,
         ERROR_UNRECOVERABLE = -2,
@@ -158,15 +180,22 @@ private:
     size_t rx_spp = 0;
 
     bool started = false;
-    bool aligned = false;
+    std::atomic<bool> aligned{false};
     bool skip_rx = false;
 
-    size_t rx_pkt_cnt = 0;
+    std::atomic<size_t> rx_pkt_cnt{0};
     size_t drop_cnt = 0;
     uhd::time_spec_t prev_ts{0, 0};
 
     TIMESTAMP ts_offset = 0;
     smpl_buf * rx_smpl_buf = nullptr;
+    std::atomic<bool> rx_running{false};
+    std::atomic<bool> rx_overrun{false};   // set when the receive thread drops a packet
+
+    tx_buf * tx_queue = nullptr;
+    std::atomic<bool> tx_running{false};
+    std::atomic<bool> tx_underrun{false};  // set when the transmit thread drops or resynchronizes
+    std::atomic<size_t> tx_late_cnt{0};
 
     void init_gains();
 
@@ -187,6 +216,8 @@ private:
     std::string str_code(uhd::async_metadata_t metadata);
 
     Thread async_event_thrd;
+    Thread rx_stream_thrd;
+    Thread tx_stream_thrd;
 };
 
 #endif //OBTS_TRANSCEIVER52M_UHDDEVICE_H
@@ -0,0 +1,733 @@
+/*
+ * SIMD Complex Vector Operations
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include "vecops.h"
+#include "simd.h"
+
+/* Base complex-scalar multiply */
+static void base_scale(float *x, const float *s, int len)
+{
+	for (int i = 0; i < len; i++) {
+		float re = x[2 * i + 0];
+		float im = x[2 * i + 1];
+
+		x[2 * i + 0] = re * s[0] - im * s[1];
+		x[2 * i + 1] = re * s[1] + im * s[0];
+	}
+}
+
+/* Base real-scalar multiply */
+static void base_scale_real(float *x, const float *s, int len)
+{
+	for (int i = 0; i < len; i++) {
+		float re = x[2 * i + 0];
+
+		x[2 * i + 0] = re * s[0];
+		x[2 * i + 1] = re * s[1];
+	}
+}
+
+/* Base complex-complex multiply */
+static void base_mul(float *x, const float *y, int len)
+{
+	for (int i = 0; i < len; i++) {
+		float re = x[2 * i + 0];
+		float im = x[2 * i + 1];
+
+		x[2 * i + 0] = re * y[2 * i + 0] - im * y[2 * i + 1];
+		x[2 * i + 1] = re * y[2 * i + 1] + im * y[2 * i + 0];
+	}
+}
+
+/* Base real-complex multiply */
+static void base_mul_real(float *x, const float *y, int len)
+{
+	for (int i = 0; i < len; i++) {
+		float re = x[2 * i + 0];
+
+		x[2 * i + 0] = re * y[2 * i + 0];
+		x[2 * i + 1] = re * y[2 * i + 1];
+	}
+}
+
+/* Base complex-scalar and complex-complex multiply */
+static void base_scale_mul(float *x, const float *s, const float *y, int len)
+{
+	for (int i = 0; i < len; i++) {
+		float re = x[2 * i + 0] * s[0] - x[2 * i + 1] * s[1];
+		float im = x[2 * i + 0] * s[1] + x[2 * i + 1] * s[0];
+
+		x[2 * i + 0] = re * y[2 * i + 0] - im * y[2 * i + 1];
+		x[2 * i + 1] = re * y[2 * i + 1] + im * y[2 * i + 0];
+	}
+}
+
+/* Base out-of-place complex-scalar multiply */
+static void base_scale_copy(float *y, const float *x, const float *s, int len)
+{
+	for (int i = 0; i < len; i++) {
+		y[2 * i + 0] = x[2 * i + 0] * s[0] - x[2 * i + 1] * s[1];
+		y[2 * i + 1] = x[2 * i + 0] * s[1] + x[2 * i + 1] * s[0];
+	}
+}
+
+static void base_conj(float *x, int len)
+{
+	for (int i = 0; i < len; i++)
+		x[2 * i + 1] = -x[2 * i + 1];
+}
+
+static void base_add(float *x, const float *y, int len)
+{
+	for (int i = 0; i < 2 * len; i++)
+		x[i] += y[i];
+}
+
+/* Base two term complex linear combination */
+static void base_lincomb(float *z, const float *x, const float *a,
+			 const float *y, const float *b, int len)
+{
+	for (int i = 0; i < len; i++) {
+		float xr = x[2 * i + 0], xi = x[2 * i + 1];
+		float yr = y[2 * i + 0], yi = y[2 * i + 1];
+
+		z[2 * i + 0] = xr * a[0] - xi * a[1] + yr * b[0] - yi * b[1];
+		z[2 * i + 1] = xr * a[1] + xi * a[0] + yr * b[1] + yi * b[0];
+	}
+}
+
+/* Base lattice rotation */
+static void base_lattice(float *x, float *y, const float *k, float c, int len)
+{
+	for (int i = 0; i < len; i++) {
+		float xr = x[2 * i + 0], xi = x[2 * i + 1];
+		float yr = y[2 * i + 0], yi = y[2 * i + 1];
+
+		x[2 * i + 0] = c * (xr + yr * k[0] + yi * k[1]);
+		x[2 * i + 1] = c * (xi + yi * k[0] - yr * k[1]);
+		y[2 * i + 0] = c * (yr - xr * k[0] + xi * k[1]);
+		y[2 * i + 1] = c * (yi - xi * k[0] - xr * k[1]);
+	}
+}
+
+static float base_norm2(const float *x, int len)
+{
+	float sum = 0.0f;
+
+	for (int i = 0; i < 2 * len; i++)
+		sum += x[i] * x[i];
+
+	return sum;
+}
+
+#ifdef HAVE_SIMD_X86
+#include <immintrin.h>
+
+/* SSE3 complex-scalar multiply */
+SIMD_TARGET("sse3")
+static void sse_scale(float *x, const float *s, int len)
+{
+	__m128 m0, m1, m2, m3;
+	int start = len / 2 * 2;
+
+	m2 = _mm_set1_ps(s[0]);
+	m3 = _mm_set1_ps(s[1]);
+
+	for (int i = 0; i < start; i += 2) {
+		m0 = _mm_loadu_ps(&x[2 * i]);
+		m1 = _mm_shuffle_ps(m0, m0, _MM_SHUFFLE(2, 3, 0, 1));
+		m0 = _mm_addsub_ps(_mm_mul_ps(m0, m2), _mm_mul_ps(m1, m3));
+		_mm_storeu_ps(&x[2 * i], m0);
+	}
+
+	base_scale(&x[2 * start], s, len - start);
+}
+
+/* SSE3 real-scalar multiply */
+SIMD_TARGET("sse3")
+static void sse_scale_real(float *x, const float *s, int len)
+{
+	__m128 m0, m1;
+	int start = len / 2 * 2;
+
+	m1 = _mm_setr_ps(s[0], s[1], s[0], s[1]);
+
+	for (int i = 0; i < start; i += 2) {
+		m0 = _mm_moveldup_ps(_mm_loadu_ps(&x[2 * i]));
+		_mm_storeu_ps(&x[2 * i], _mm_mul_ps(m0, m1));
+	}
+
+	base_scale_real(&x[2 * start], s, len - start);
+}
+
+/* SSE3 complex multiply of two vectors */
+SIMD_TARGET("sse3")
+static inline __m128 sse_cmul(__m128 m0, __m128 m1)
+{
+	__m128 m2, m3;
+
+	m2 = _mm_mul_ps(_mm_moveldup_ps(m0), m1);
+	m3 = _mm_mul_ps(_mm_movehdup_ps(m0),
+			_mm_shuffle_ps(m1, m1, _MM_SHUFFLE(2, 3, 0, 1)));
+
+	return _mm_addsub_ps(m2, m3);
+}
+
+/* SSE3 complex-complex multiply */
+SIMD_TARGET("sse3")
+static void sse_mul(float *x, const float *y, int len)
+{
+	__m128 m0, m1;
+	int start = len / 2 * 2;
+
+	for (int i = 0; i < start; i += 2) {
+		m0 = _mm_loadu_ps(&x[2 * i]);
+		m1 = _mm_loadu_ps(&y[2 * i]);
+		_mm_storeu_ps(&x[2 * i], sse_cmul(m0, m1));
+	}
+
+	base_mul(&x[2 * start], &y[2 * start], len - start);
+}
+
+/* SSE3 real-complex multiply */
+SIMD_TARGET("sse3")
+static void sse_mul_real(float *x, const float *y, int len)
+{
+	__m128 m0, m1;
+	int start = len / 2 * 2;
+
+	for (int i = 0; i < start; i += 2) {
+		m0 = _mm_moveldup_ps(_mm_loadu_ps(&x[2 * i]));
+		m1 = _mm_loadu_ps(&y[2 * i]);
+		_mm_storeu_ps(&x[2 * i], _mm_mul_ps(m0, m1));
+	}
+
+	base_mul_real(&x[2 * start], &y[2 * start], len - start);
+}
+
+/* SSE3 complex-scalar and complex-complex multiply */
+SIMD_TARGET("sse3")
+static void sse_scale_mul(float *x, const float *s, const float *y, int len)
+{
+	__m128 m0, m1, m2;
+	int start = len / 2 * 2;
+
+	m2 = _mm_setr_ps(s[0], s[1], s[0], s[1]);
+
+	for (int i = 0; i < start; i += 2) {
+		m0 = sse_cmul(_mm_loadu_ps(&x[2 * i]), m2);
+		m1 = _mm_loadu_ps(&y[2 * i]);
+		_mm_storeu_ps(&x[2 * i], sse_cmul(m0, m1));
+	}
+
+	base_scale_mul(&x[2 * start], s, &y[2 * start], len - start);
+}
+
+/* SSE3 out-of-place complex-scalar multiply */
+SIMD_TARGET("sse3")
+static void sse_scale_copy(float *y, const float *x, const float *s, int len)
+{
+	__m128 m0, m1;
+	int start = len / 2 * 2;
+
+	m1 = _mm_setr_ps(s[0], s[1], s[0], s[1]);
+
+	for (int i = 0; i < start; i += 2) {
+		m0 = _mm_loadu_ps(&x[2 * i]);
+		_mm_storeu_ps(&y[2 * i], sse_cmul(m0, m1));
+	}
+
+	base_scale_copy(&y[2 * start], &x[2 * start], s, len - start);
+}
+
+SIMD_TARGET("sse3")
+static void sse_conj(float *x, int len)
+{
+	__m128 m0, m1;
+	int start = len / 2 * 2;
+
+	m1 = _mm_setr_ps(0.0f, -0.0f, 0.0f, -0.0f);
+
+	for (int i = 0; i < start; i += 2) {
+		m0 = _mm_loadu_ps(&x[2 * i]);
+		_mm_storeu_ps(&x[2 * i], _mm_xor_ps(m0, m1));
+	}
+
+	base_conj(&x[2 * start], len - start);
+}
+
+SIMD_TARGET("sse3")
+static void sse_add(float *x, const float *y, int len)
+{
+	__m128 m0, m1;
+	int start = len / 2 * 2;
+
+	for (int i = 0; i < start; i += 2) {
+		m0 = _mm_loadu_ps(&x[2 * i]);
+		m1 = _mm_loadu_ps(&y[2 * i]);
+		_mm_storeu_ps(&x[2 * i], _mm_add_ps(m0, m1));
+	}
+
+	base_add(&x[2 * start], &y[2 * start], len - start);
+}
+
+/* SSE3 two term complex linear combination */
+SIMD_TARGET("sse3")
+static void sse_lincomb(float *z, const float *x, const float *a,
+			const float *y, const float *b, int len)
+{
+	__m128 m0, m1, m2, m3;
+	int start = len / 2 * 2;
+
+	m2 = _mm_setr_ps(a[0], a[1], a[0], a[1]);
+	m3 = _mm_setr_ps(b[0], b[1], b[0], b[1]);
+
+	for (int i = 0; i < start; i += 2) {
+		m0 = sse_cmul(_mm_loadu_ps(&x[2 * i]), m2);
+		m1 = sse_cmul(_mm_loadu_ps(&y[2 * i]), m3);
+		_mm_storeu_ps(&z[2 * i], _mm_add_ps(m0, m1));
+	}
+
+	base_lincomb(&z[2 * start], &x[2 * start], a,
+		     &y[2 * start], b, len - start);
+}
+
+/* SSE3 lattice rotation */
+SIMD_TARGET("sse3")
+static void sse_lattice(float *x, float *y, const float *k, float c, int len)
+{
+	__m128 m0, m1, m2, m3, m4;
+	int start = len / 2 * 2;
+
+	m2 = _mm_setr_ps(k[0], k[1], k[0], k[1]);
+	m3 = _mm_setr_ps(k[0], -k[1], k[0], -k[1]);
+	m4 = _mm_set1_ps(c);
+
+	for (int i = 0; i < start; i += 2) {
+		m0 = _mm_loadu_ps(&x[2 * i]);
+		m1 = _mm_loadu_ps(&y[2 * i]);
+		_mm_storeu_ps(&x[2 * i],
+			      _mm_mul_ps(m4, _mm_add_ps(m0, sse_cmul(m1, m3))));
+		_mm_storeu_ps(&y[2 * i],
+			      _mm_mul_ps(m4, _mm_sub_ps(m1, sse_cmul(m0, m2))));
+	}
+
+	base_lattice(&x[2 * start], &y[2 * start], k, c, len - start);
+}
+
+SIMD_TARGET("sse3")
+static float sse_norm2(const float *x, int len)
+{
+	__m128 m0, m1;
+	int start = len / 2 * 2;
+
+	m1 = _mm_setzero_ps();
+
+	for (int i = 0; i < start; i += 2) {
+		m0 = _mm_loadu_ps(&x[2 * i]);
+		m1 = _mm_add_ps(m1, _mm_mul_ps(m0, m0));
+	}
+
+	m1 = _mm_hadd_ps(m1, m1);
+	m1 = _mm_hadd_ps(m1, m1);
+
+	return _mm_cvtss_f32(m1) + base_norm2(&x[2 * start], len - start);
+}
+
+/*
+ * The generic remainder loops are built without VEX encoding, so the AVX2
+ * kernels clear the upper register halves before handing over to them.
+ * Otherwise short vectors pay an SSE/AVX transition penalty far larger
+ * than the work itself.
+ */
+
+/* AVX2/FMA complex multiply of two vectors */
+SIMD_TARGET("avx2,fma")
+static inline __m256 avx2_cmul(__m256 m0, __m256 m1)
+{
+	__m256 m2;
+
+	m2 = _mm256_mul_ps(_mm256_movehdup_ps(m0),
+			   _mm256_permute_ps(m1, _MM_SHUFFLE(2, 3, 0, 1)));
+
+	return _mm256_fmaddsub_ps(_mm256_moveldup_ps(m0), m1, m2);
+}
+
+/* AVX2/FMA complex-scalar multiply */
+SIMD_TARGET("avx2,fma")
+static void avx2_scale(float *x, const float *s, int len)
+{
+	__m256 m0, m1, m2, m3;
+	int start = len / 4 * 4;
+
+	m2 = _mm256_set1_ps(s[0]);
+	m3 = _mm256_set1_ps(s[1]);
+
+	for (int i = 0; i < start; i += 4) {
+		m0 = _mm256_loadu_ps(&x[2 * i]);
+		m1 = _mm256_permute_ps(m0, _MM_SHUFFLE(2, 3, 0, 1));
+		m0 = _mm256_fmaddsub_ps(m0, m2, _mm256_mul_ps(m1, m3));
+		_mm256_storeu_ps(&x[2 * i], m0);
+	}
+
+	_mm256_zeroupper();
+	base_scale(&x[2 * start], s, len - start);
+}
+
+/* AVX2/FMA real-scalar multiply */
+SIMD_TARGET("avx2,fma")
+static void avx2_scale_real(float *x, const float *s, int len)
+{
+	__m256 m0, m1;
+	int start = len / 4 * 4;
+
+	m1 = _mm256_setr_ps(s[0], s[1], s[0], s[1],
+			    s[0], s[1], s[0], s[1]);
+
+	for (int i = 0; i < start; i += 4) {
+		m0 = _mm256_moveldup_ps(_mm256_loadu_ps(&x[2 * i]));
+		_mm256_storeu_ps(&x[2 * i], _mm256_mul_ps(m0, m1));
+	}
+
+	_mm256_zeroupper();
+	base_scale_real(&x[2 * start], s, len - start);
+}
+
+/* AVX2/FMA complex-complex multiply */
+SIMD_TARGET("avx2,fma")
+static void avx2_mul(float *x, const float *y, int len)
+{
+	__m256 m0, m1;
+	int start = len / 4 * 4;
+
+	for (int i = 0; i < start; i += 4) {
+		m0 = _mm256_loadu_ps(&x[2 * i]);
+		m1 = _mm256_loadu_ps(&y[2 * i]);
+		_mm256_storeu_ps(&x[2 * i], avx2_cmul(m0, m1));
+	}
+
+	_mm256_zeroupper();
+	base_mul(&x[2 * start], &y[2 * start], len - start);
+}
+
+/* AVX2/FMA real-complex multiply */
+SIMD_TARGET("avx2,fma")
+static void avx2_mul_real(float *x, const float *y, int len)
+{
+	__m256 m0, m1;
+	int start = len / 4 * 4;
+
+	for (int i = 0; i < start; i += 4) {
+		m0 = _mm256_moveldup_ps(_mm256_loadu_ps(&x[2 * i]));
+		m1 = _mm256_loadu_ps(&y[2 * i]);
+		_mm256_storeu_ps(&x[2 * i], _mm256_mul_ps(m0, m1));
+	}
+
+	_mm256_zeroupper();
+	base_mul_real(&x[2 * start], &y[2 * start], len - start);
+}
+
+/* AVX2/FMA complex-scalar and complex-complex multiply */
+SIMD_TARGET("avx2,fma")
+static void avx2_scale_mul(float *x, const float *s, const float *y, int len)
+{
+	__m256 m0, m1, m2;
+	int start = len / 4 * 4;
+
+	m2 = _mm256_setr_ps(s[0], s[1], s[0], s[1],
+			    s[0], s[1], s[0], s[1]);
+
+	for (int i = 0; i < start; i += 4) {
+		m0 = avx2_cmul(_mm256_loadu_ps(&x[2 * i]), m2);
+		m1 = _mm256_loadu_ps(&y[2 * i]);
+		_mm256_storeu_ps(&x[2 * i], avx2_cmul(m0, m1));
+	}
+
+	_mm256_zeroupper();
+	base_scale_mul(&x[2 * start], s, &y[2 * start], len - start);
+}
+
+/* AVX2/FMA out-of-place complex-scalar multiply */
+SIMD_TARGET("avx2,fma")
+static void avx2_scale_copy(float *y, const float *x, const float *s, int len)
+{
+	__m256 m0, m1;
+	int start = len / 4 * 4;
+
+	m1 = _mm256_setr_ps(s[0], s[1], s[0], s[1],
+			    s[0], s[1], s[0], s[1]);
+
+	for (int i = 0; i < start; i += 4) {
+		m0 = _mm256_loadu_ps(&x[2 * i]);
+		_mm256_storeu_ps(&y[2 * i], avx2_cmul(m0, m1));
+	}
+
+	_mm256_zeroupper();
+	base_scale_copy(&y[2 * start], &x[2 * start], s, len - start);
+}
+
+SIMD_TARGET("avx2")
+static void avx2_conj(float *x, int len)
+{
+	__m256 m0, m1;
+	int start = len / 4 * 4;
+
+	m1 = _mm256_setr_ps(0.0f, -0.0f, 0.0f, -0.0f,
+			    0.0f, -0.0f, 0.0f, -0.0f);
+
+	for (int i = 0; i < start; i += 4) {
+		m0 = _mm256_loadu_ps(&x[2 * i]);
+		_mm256_storeu_ps(&x[2 * i], _mm256_xor_ps(m0, m1));
+	}
+
+	_mm256_zeroupper();
+	base_conj(&x[2 * start], len - start);
+}
+
+SIMD_TARGET("avx2")
+static void avx2_add(float *x, const float *y, int len)
+{
+	__m256 m0, m1;
+	int start = len / 4 * 4;
+
+	for (int i = 0; i < start; i += 4) {
+		m0 = _mm256_loadu_ps(&x[2 * i]);
+		m1 = _mm256_loadu_ps(&y[2 * i]);
+		_mm256_storeu_ps(&x[2 * i], _mm256_add_ps(m0, m1));
+	}
+
+	_mm256_zeroupper();
+	base_add(&x[2 * start], &y[2 * start], len - start);
+}
+
+/* AVX2/FMA two term complex linear combination */
+SIMD_TARGET("avx2,fma")
+static void avx2_lincomb(float *z, const float *x, const float *a,
+			 const float *y, const float *b, int len)
+{
+	__m256 m0, m1, m2, m3;
+	int start = len / 4 * 4;
+
+	m2 = _mm256_setr_ps(a[0], a[1], a[0], a[1],
+			    a[0], a[1], a[0], a[1]);
+	m3 = _mm256_setr_ps(b[0], b[1], b[0], b[1],
+			    b[0], b[1], b[0], b[1]);
+
+	for (int i = 0; i < start; i += 4) {
+		m0 = avx2_cmul(_mm256_loadu_ps(&x[2 * i]), m2);
+		m1 = avx2_cmul(_mm256_loadu_ps(&y[2 * i]), m3);
+		_mm256_storeu_ps(&z[2 * i], _mm256_add_ps(m0, m1));
+	}
+
+	_mm256_zeroupper();
+	base_lincomb(&z[2 * start], &x[2 * start], a,
+		     &y[2 * start], b, len - start);
+}
+
+/* AVX2/FMA lattice rotation */
+SIMD_TARGET("avx2,fma")
+static void avx2_lattice(float *x, float *y, const float *k, float c, int len)
+{
+	__m256 m0, m1, m2, m3, m4;
+	int start = len / 4 * 4;
+
+	m2 = _mm256_setr_ps(k[0], k[1], k[0], k[1],
+			    k[0], k[1], k[0], k[1]);
+	m3 = _mm256_setr_ps(k[0], -k[1], k[0], -k[1],
+			    k[0], -k[1], k[0], -k[1]);
+	m4 = _mm256_set1_ps(c);
+
+	for (int i = 0; i < start; i += 4) {
+		m0 = _mm256_loadu_ps(&x[2 * i]);
+		m1 = _mm256_loadu_ps(&y[2 * i]);
+		_mm256_storeu_ps(&x[2 * i],
+				 _mm256_mul_ps(m4, _mm256_add_ps(m0, avx2_cmul(m1, m3))));
+		_mm256_storeu_ps(&y[2 * i],
+				 _mm256_mul_ps(m4, _mm256_sub_ps(m1, avx2_cmul(m0, m2))));
+	}
+
+	_mm256_zeroupper();
+	base_lattice(&x[2 * start], &y[2 * start], k, c, len - start);
+}
+
+SIMD_TARGET("avx2,fma")
+static float avx2_norm2(const float *x, int len)
+{
+	__m256 m0;
+	__m128 m1;
+	int start = len / 4 * 4;
+
+	m0 = _mm256_setzero_ps();
+
+	for (int i = 0; i < start; i += 4) {
+		__m256 m2 = _mm256_loadu_ps(&x[2 * i]);
+		m0 = _mm256_fmadd_ps(m2, m2, m0);
+	}
+
+	m1 = _mm_add_ps(_mm256_castps256_ps128(m0),
+			_mm256_extractf128_ps(m0, 1));
+	m1 = _mm_hadd_ps(m1, m1);
+	m1 = _mm_hadd_ps(m1, m1);
+
+	return _mm_cvtss_f32(m1) + base_norm2(&x[2 * start], len - start);
+}
+#endif /* HAVE_SIMD_X86 */
+
+/*
+ * Vector kernel registry, ordered from widest to narrowest instruction
+ * set. All kernels accept any length and handle the remainder internally.
+ */
+struct vec_backend {
+	const char *name;
+	int flags;
+	void (*scale)(float *x, const float *s, int len);
+	void (*scale_real)(float *x, const float *s, int len);
+	void (*mul)(float *x, const float *y, int len);
+	void (*mul_real)(float *x, const float *y, int len);
+	void (*scale_mul)(float *x, const float *s, const float *y, int len);
+	void (*scale_copy)(float *y, const float *x, const float *s, int len);
+	void (*conj)(float *x, int len);
+	void (*add)(float *x, const float *y, int len);
+	float (*norm2)(const float *x, int len);
+	void (*lincomb)(float *z, const float *x, const float *a,
+			const float *y, const float *b, int len);
+	void (*lattice)(float *x, float *y, const float *k, float c, int len);
+};
+
+static const struct vec_backend vec_backends[] = {
+#ifdef HAVE_SIMD_X86
+	{ "AVX2/FMA", SIMD_AVX2,
+	  avx2_scale, avx2_scale_real, avx2_mul, avx2_mul_real,
+	  avx2_scale_mul, avx2_scale_copy, avx2_conj, avx2_add, avx2_norm2,
+	  avx2_lincomb, avx2_lattice },
+	{ "SSE3", SIMD_SSE3,
+	  sse_scale, sse_scale_real, sse_mul, sse_mul_real,
+	  sse_scale_mul, sse_scale_copy, sse_conj, sse_add, sse_norm2,
+	  sse_lincomb, sse_lattice },
+#endif
+	{ "generic", 0,
+	  base_scale, base_scale_real, base_mul, base_mul_real,
+	  base_scale_mul, base_scale_copy, base_conj, base_add, base_norm2,
+	  base_lincomb, base_lattice },
+};
+
+#define NUM_VEC_BACKENDS \
+	(sizeof(vec_backends) / sizeof(vec_backends[0]))
+
+static const struct vec_backend *vec_backend =
+	&vec_backends[NUM_VEC_BACKENDS - 1];
+
+/* API: Select the widest kernel set supported by the running CPU */
+const char *vec_init(void)
+{
+	int flags = simd_probe();
+
+	for (size_t i = 0; i < NUM_VEC_BACKENDS; i++) {
+		if ((vec_backends[i].flags & flags) == vec_backends[i].flags) {
+			vec_backend = &vec_backends[i];
+			break;
+		}
+	}
+
+	return vec_backend->name;
+}
+
+void vec_scale(float *x, const float *s, int len)
+{
+	vec_backend->scale(x, s, len);
+}
+
+void vec_scale_real(float *x, const float *s, int len)
+{
+	vec_backend->scale_real(x, s, len);
+}
+
+void vec_mul(float *x, const float *y, int len)
+{
+	vec_backend->mul(x, y, len);
+}
+
+void vec_mul_real(float *x, const float *y, int len)
+{
+	vec_backend->mul_real(x, y, len);
+}
+
+void vec_scale_mul(float *x, const float *s, const float *y, int len)
+{
+	vec_backend->scale_mul(x, s, y, len);
+}
+
+void vec_scale_copy(float *y, const float *x, const float *s, int len)
+{
+	vec_backend->scale_copy(y, x, s, len);
+}
+
+void vec_conj(float *x, int len)
+{
+	vec_backend->conj(x, len);
+}
+
+void vec_add(float *x, const float *y, int len)
+{
+	vec_backend->add(x, y, len);
+}
+
+float vec_norm2(const float *x, int len)
+{
+	return vec_backend->norm2(x, len);
+}
+
+void vec_lincomb(float *z, const float *x, const float *a,
+		 const float *y, const float *b, int len)
+{
+	vec_backend->lincomb(z, x, a, y, b, len);
+}
+
+void vec_lattice(float *x, float *y, const float *k, float c, int len)
+{
+	vec_backend->lattice(x, y, k, c, len);
+}
+
+/* Strided access does not vectorise usefully, so there is no kernel */
+float vec_norm2_strided(const float *x, int len, int stride)
+{
+	float sum = 0.0f;
+
+	if (stride == 1)
+		return vec_norm2(x, len);
+
+	for (int i = 0; i < len; i++) {
+		const float *_x = &x[2 * i * stride];
+
+		sum += _x[0] * _x[0] + _x[1] * _x[1];
+	}
+
+	return sum;
+}
+
+void vec_decimate(float *y, const float *x, int len, int factor)
+{
+	for (int i = 0; i < len; i++) {
+		y[2 * i + 0] = x[2 * i * factor + 0];
+		y[2 * i + 1] = x[2 * i * factor + 1];
+	}
+}
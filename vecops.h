@@ -0,0 +1,47 @@
+#ifndef _VECOPS_H_
+#define _VECOPS_H_
+
+/*
+ * Element-wise operations on interleaved complex float vectors. Lengths
+ * are in complex samples and complex scalars are passed as (re, im) pairs.
+ * Operations ending in _real use only the real part of x.
+ */
+
+/* Probe the CPU and select vector kernels, returns the kernel set name */
+const char *vec_init(void);
+
+/* x = x * s */
+void vec_scale(float *x, const float *s, int len);
+void vec_scale_real(float *x, const float *s, int len);
+
+/* x = x * y */
+void vec_mul(float *x, const float *y, int len);
+void vec_mul_real(float *x, const float *y, int len);
+
+/* x = x * s * y */
+void vec_scale_mul(float *x, const float *s, const float *y, int len);
+
+/* y = x * s, vectors may not overlap */
+void vec_scale_copy(float *y, const float *x, const float *s, int len);
+
+/* x = conj(x) */
+void vec_conj(float *x, int len);
+
+/* x = x + y */
+void vec_add(float *x, const float *y, int len);
+
+/* z = x * a + y * b, z may be x or y */
+void vec_lincomb(float *z, const float *x, const float *a,
+		 const float *y, const float *b, int len);
+
+/* x, y = c * (x + conj(k) * y), c * (y - k * x), one lattice filter stage */
+void vec_lattice(float *x, float *y, const float *k, float c, int len);
+
+/* Sum of |x|^2, over len samples spaced by stride for the strided form */
+float vec_norm2(const float *x, int len);
+float vec_norm2_strided(const float *x, int len, int stride);
+
+/* y[i] = x[i * factor] for i < len, y may be x for in place decimation */
+void vec_decimate(float *y, const float *x, int len, int factor);
+
+#endif /* _VECOPS_H_ */